@@ -10,4 +10,5 @@ ADD_SUBDIRECTORY (src-lib)
 ADD_SUBDIRECTORY (src-tool)
 ADD_SUBDIRECTORY (src-apps)
 ADD_SUBDIRECTORY (src-cam)
+ADD_SUBDIRECTORY (src-python)
 ADD_SUBDIRECTORY (src-doc)
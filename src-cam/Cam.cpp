@@ -5,6 +5,7 @@
 
 
 #include "DarkHelp.hpp"
+#include "DarkHelpFrameGrabber.hpp"
 #include "CamOptions.hpp"
 
 
@@ -200,11 +201,39 @@ int main(int argc, char * argv[])
 		std::map<std::string, size_t> m;
 		std::string previously_seen_objects;
 
-		size_t frame_counter = 0;
-		while (cap.isOpened() and errors < 5)
+		/* When reading from a live camera, frames are read on a secondary thread and we always run inference on the most
+		 * recent frame.  This way the time it takes to read a frame isn't added to the inference time, and stale frames
+		 * don't pile up in the camera buffers when inference is slower than the camera.  Video files are still read on
+		 * this thread since we don't want to drop any frames.
+		 */
+		std::unique_ptr<DarkHelp::FrameGrabber> grabber;
+		if (options.device_index >= 0)
+		{
+			grabber = std::make_unique<DarkHelp::FrameGrabber>(cap);
+		}
+
+		/* The frame counter is the number of frames processed, while the video frame is the position in the video.  These
+		 * are the same for video files, but when the grabber drops frames the video frame skips ahead.  The position in the
+		 * video is what must be used to decide how long to capture and how many frames to write to the output video,
+		 * otherwise the output would play back time-compressed and capturing would run for longer than requested.
+		 */
+		size_t frame_counter		= 0;
+		size_t video_frame			= 0;
+		size_t first_camera_frame	= 0;
+		size_t frames_written		= 0;
+
+		// while the grabber is running it owns the video capture object, so we cannot call cap.isOpened()
+		while (errors < 5 and (grabber ? grabber->is_running() : cap.isOpened()))
 		{
 			cv::Mat frame;
-			cap >> frame;
+			if (grabber)
+			{
+				frame = grabber->get_latest_frame();
+			}
+			else
+			{
+				cap >> frame;
+			}
 			if (frame.empty())
 			{
 				// Was the camera disconnected?  Or a bad frame?  End of the video?
@@ -218,6 +247,17 @@ int main(int argc, char * argv[])
 				std::cout << "\rframe #" << frame_counter << " " << std::flush;
 			}
 			frame_counter ++;
+			video_frame = frame_counter;
+
+			if (grabber)
+			{
+				const size_t camera_frame = grabber->frames_read();
+				if (frame_counter == 1)
+				{
+					first_camera_frame = camera_frame;
+				}
+				video_frame = camera_frame - first_camera_frame + 1;
+			}
 
 			if (resize_before)
 			{
@@ -233,19 +273,19 @@ int main(int argc, char * argv[])
 				const auto & key = nn.names[pred.best_class];
 #if 0
 				if (m.count(key) == 0 or						// object was previously undetected...
-					m[key] + fps_rounded * 2 < frame_counter)	// ...or was last seen more than 2 seconds ago
+					m[key] + fps_rounded * 2 < video_frame)		// ...or was last seen more than 2 seconds ago
 				{
 					new_object_found = true;
 				}
 #endif
-				m[key] = frame_counter;
+				m[key] = video_frame;
 			}
 
 			// come up with a new string of recently seen objects
 			std::string str;
 			for (const auto & [key, val] : m)
 			{
-				if (val + fps_rounded * 4 >= frame_counter)
+				if (val + fps_rounded * 4 >= video_frame)
 				{
 					// we're recently seen this object
 					if (not str.empty())
@@ -257,7 +297,7 @@ int main(int argc, char * argv[])
 			}
 			if (str != previously_seen_objects)
 			{
-				std::cout << "\rframe #" << frame_counter << ": " << str << std::endl;
+				std::cout << "\rframe #" << video_frame << ": " << str << std::endl;
 				previously_seen_objects = str;
 			}
 
@@ -268,10 +308,15 @@ int main(int argc, char * argv[])
 
 			if (output.isOpened())
 			{
-				output.write(frame);
+				// if frames were dropped then repeat this one so the output plays back at the same speed as the camera
+				while (frames_written < video_frame)
+				{
+					output.write(frame);
+					frames_written ++;
+				}
 			}
 
-			if (max_frame_counter > 0 and frame_counter > max_frame_counter)
+			if (max_frame_counter > 0 and video_frame > max_frame_counter)
 			{
 				std::cout << std::endl << "Exiting!" << std::endl;
 				break;
@@ -288,6 +333,12 @@ int main(int argc, char * argv[])
 				}
 			}
 		}
+
+		if (grabber)
+		{
+			grabber->stop();
+			std::cout << "-> camera frames read: " << grabber->frames_read() << ", dropped: " << grabber->frames_dropped() << ", errors: " << grabber->read_errors() << std::endl;
+		}
 	}
 	catch (const std::exception & e)
 	{
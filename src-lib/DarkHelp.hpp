@@ -8,7 +8,9 @@
 #include <chrono>
 #include <filesystem>
 #include <map>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <list>
 #include <opencv2/opencv.hpp>
@@ -124,6 +126,8 @@ namespace DarkHelp
 #include "DarkHelpConfig.hpp"
 #include "DarkHelpNN.hpp"
 #include "DarkHelpUtils.hpp"
+#include "DarkHelpBundle.hpp"
+#include "DarkHelpModelCache.hpp"
 #include "DarkHelpPositionTracker.hpp"
 
 /* The C API should not be required or necessary when using the C++ API,
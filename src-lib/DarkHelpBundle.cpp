@@ -0,0 +1,252 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#include "DarkHelp.hpp"
+#include <cstring>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+static_assert(sizeof(DarkHelp::Bundle::HeadV1) == 4 + 2 + 2 + 2 + 4);	// 14 bytes
+static_assert(sizeof(DarkHelp::Bundle::HeadV2) == 4 + 4 + 4 + 4 + 8 * 6);	// 64 bytes
+
+
+DarkHelp::Bundle::Bundle(const std::filesystem::path & filename, const std::string & key) :
+	obfuscation_key(key),
+	bundle_version(0),
+	data(nullptr),
+	size(0)
+	#ifdef WIN32
+	, file_handle(INVALID_HANDLE_VALUE)
+	, mapping_handle(nullptr)
+	#endif
+{
+	if (not std::filesystem::exists(filename) or
+		not std::filesystem::is_regular_file(filename))
+	{
+		/// @throw std::invalid_argument if the bundle does not exist or is not a regular file.
+		throw std::invalid_argument("DarkHelp bundle does not exist or is not a regular file (" + filename.string() + ")");
+	}
+
+	size = std::filesystem::file_size(filename);
+	if (size < sizeof(HeadV1))
+	{
+		/// @throw std::invalid_argument if the bundle is too small to be valid.
+		throw std::invalid_argument("invalid DarkHelp bundle (file is too small): " + filename.string());
+	}
+
+	#ifdef WIN32
+	file_handle = CreateFileW(filename.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file_handle != INVALID_HANDLE_VALUE)
+	{
+		mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	if (mapping_handle)
+	{
+		data = reinterpret_cast<const uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	}
+	#else
+	const int fd = open(filename.string().c_str(), O_RDONLY);
+	if (fd >= 0)
+	{
+		void * ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ptr != MAP_FAILED)
+		{
+			data = reinterpret_cast<const uint8_t*>(ptr);
+		}
+
+		// the mapping remains valid once the file descriptor is closed
+		close(fd);
+	}
+	#endif
+
+	if (data == nullptr)
+	{
+		unmap();
+
+		/// @throw std::runtime_error if the bundle cannot be memory-mapped.
+		throw std::runtime_error("failed to map the DarkHelp bundle " + filename.string());
+	}
+
+	if (data[0] != 'D' or data[1] != 'H' or data[2] != 0 or (data[3] != 1 and data[3] != 2))
+	{
+		unmap();
+
+		/// @throw std::invalid_argument if the bundle is neither version 1 nor version 2.
+		throw std::invalid_argument("invalid DarkHelp bundle (version mismatch): " + filename.string());
+	}
+
+	bundle_version = data[3];
+
+	size_t expected_filesize = 0;
+	if (bundle_version == 1)
+	{
+		HeadV1 head;
+		uint8_t * ptr = reinterpret_cast<uint8_t*>(&head);
+		std::memcpy(ptr, data, sizeof(head));
+
+		// skip the first 4 bytes (DH01) and deobfuscate the rest of the head structure
+		obfuscate(key, 4, ptr + 4, ptr + 4, sizeof(head) - 4);
+
+		cfg_section.offset		= sizeof(HeadV1) + head.padding_size;
+		cfg_section.size		= head.cfg_size;
+		names_section.offset	= cfg_section.offset + cfg_section.size;
+		names_section.size		= head.names_size;
+		weights_section.offset	= names_section.offset + names_section.size;
+		weights_section.size	= head.weights_size;
+		expected_filesize		= weights_section.offset + weights_section.size;
+	}
+	else
+	{
+		HeadV2 head;
+		if (size < sizeof(head))
+		{
+			unmap();
+			throw std::invalid_argument("invalid DarkHelp bundle (file is too small): " + filename.string());
+		}
+		std::memcpy(&head, data, sizeof(head));
+
+		if (head.head_size < sizeof(head))
+		{
+			unmap();
+			throw std::invalid_argument("invalid DarkHelp bundle (header size mismatch): " + filename.string());
+		}
+
+		const bool obfuscated = (head.flags & kFlagObfuscated);
+		if (obfuscated and key.empty())
+		{
+			unmap();
+			/// @throw std::invalid_argument if the bundle is obfuscated but no key was provided.
+			throw std::invalid_argument("DarkHelp bundle is obfuscated and requires a key: " + filename.string());
+		}
+		if (obfuscated)
+		{
+			// skip the first few bytes and deobfuscate the section offsets and sizes
+			uint8_t * ptr = reinterpret_cast<uint8_t*>(&head);
+			obfuscate(key, kPlainHeadSize, ptr + kPlainHeadSize, ptr + kPlainHeadSize, sizeof(head) - kPlainHeadSize);
+		}
+		else
+		{
+			// the bundle was created without a key, so ignore whatever key the caller gave us
+			obfuscation_key.clear();
+		}
+
+		cfg_section.offset		= head.cfg_offset;
+		cfg_section.size		= head.cfg_size;
+		names_section.offset	= head.names_offset;
+		names_section.size		= head.names_size;
+		weights_section.offset	= head.weights_offset;
+		weights_section.size	= head.weights_size;
+
+		/* The sections must be in order, must not overlap, and must be aligned.  With an incorrect key, the decoded
+		 * offsets and sizes are random, and the chance of them describing a valid bundle is negligible.
+		 */
+		bool valid = (head.alignment > 0);
+		uint64_t minimum_offset = head.head_size;
+		for (const auto * section : {&cfg_section, &names_section, &weights_section})
+		{
+			if (not valid or
+				section->offset < minimum_offset or
+				section->offset % head.alignment != 0 or
+				section->size > size or
+				section->offset > size - section->size)
+			{
+				valid = false;
+				break;
+			}
+			minimum_offset = section->offset + section->size;
+		}
+
+		// the last section is not padded, so the end of the weights should be the end of the file
+		if (not valid or weights_section.offset + weights_section.size != size)
+		{
+			unmap();
+			if (obfuscated)
+			{
+				/// @throw std::invalid_argument if the key does not match the one used to create the bundle.
+				throw std::invalid_argument("invalid key for DarkHelp bundle (or the bundle is corrupt): " + filename.string());
+			}
+			throw std::invalid_argument("invalid DarkHelp bundle (size mismatch): " + filename.string());
+		}
+		expected_filesize = size;
+	}
+
+	if (expected_filesize != size)
+	{
+		unmap();
+		/// @throw std::invalid_argument if the sizes in the header don't match the size of the bundle.
+		throw std::invalid_argument("invalid DarkHelp bundle (size mismatch): " + filename.string());
+	}
+
+	return;
+}
+
+
+DarkHelp::Bundle::~Bundle()
+{
+	unmap();
+
+	return;
+}
+
+
+void DarkHelp::Bundle::unmap()
+{
+	#ifdef WIN32
+	if (data)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mapping_handle)
+	{
+		CloseHandle(mapping_handle);
+	}
+	if (file_handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file_handle);
+	}
+	mapping_handle	= nullptr;
+	file_handle		= INVALID_HANDLE_VALUE;
+	#else
+	if (data)
+	{
+		munmap(const_cast<uint8_t*>(data), size);
+	}
+	#endif
+
+	data = nullptr;
+
+	return;
+}
+
+
+std::string_view DarkHelp::Bundle::get(Section & section)
+{
+	const char * ptr = reinterpret_cast<const char *>(data + section.offset);
+
+	if (obfuscation_key.empty())
+	{
+		// nothing to decode, use the section directly from the mapped file
+		return std::string_view(ptr, section.size);
+	}
+
+	if (not section.buffer)
+	{
+		// decode directly from the mapped file into the buffer, which is intentionally left uninitialized
+		section.buffer.reset(new char[section.size]);
+		obfuscate(obfuscation_key, 0, ptr, section.buffer.get(), section.size);
+	}
+
+	return std::string_view(section.buffer.get(), section.size);
+}
+
@@ -0,0 +1,146 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#pragma once
+
+#include "DarkHelp.hpp"
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+
+/** @file
+ * %DarkHelp's class to read the @p .dh bundle files created by @p DarkHelpCombine.
+ */
+
+
+namespace DarkHelp
+{
+	/** Read a bundle file created by @ref DarkHelp::combine() (or the @p DarkHelpCombine command-line tool) directly from
+	 * memory, without first extracting the @p .cfg, @p .names, and @p .weights files to disk.
+	 *
+	 * The bundle file is memory-mapped.  When a version 2 bundle is not obfuscated, the 3 sections are used as-is from the
+	 * mapped memory, and the operating system only reads the pages that are accessed.  Obfuscated bundles and version 1
+	 * bundles are decoded into memory the first time each section is accessed.
+	 *
+	 * Version 1 bundles are a @ref HeadV1, random padding bytes, and the 3 sections packed one after the other.  Version 2
+	 * bundles start with @ref HeadV2.  When a version 2 bundle is not obfuscated, each section starts on a 4 KiB boundary
+	 * so it can be used directly from the mapped memory.  When it is obfuscated, the sections have to be decoded anyway,
+	 * so like version 1 they are packed one after the other following a random amount of random padding.
+	 *
+	 * Both versions obfuscate the sections the same way, by applying XOR to each byte of the section with the byte of the
+	 * key at the same position, where the key is repeated as many times as needed to cover the section.  The sizes and
+	 * offsets in the header are also obfuscated.  Neither version stores anything derived from the key; an incorrect key
+	 * is detected because the decoded sizes and offsets don't describe a valid bundle.
+	 *
+	 * Older versions of %DarkHelp only know about version 1 bundles, and cannot read version 2 bundles.
+	 *
+	 * @note Accessing the sections is not thread-safe, since the first access to an obfuscated section will decode it.
+	 *
+	 * @see @ref DarkHelp::NN::init()
+	 *
+	 * @since 2026-10-16
+	 */
+	class Bundle final
+	{
+		public:
+
+			#pragma pack(push, 1)
+			/// The header used by version 1 bundles.  Everything after the first 4 bytes is obfuscated.
+			struct HeadV1
+			{
+				uint8_t header[4];		///< @p "DH" followed by the major version @p 0 and the minor version @p 1.
+				// uint16_t gives us a max file size of 64 KiB - 1, while most config files are a few KiB in size
+				uint16_t padding_size;
+				uint16_t cfg_size;
+				uint16_t names_size;
+				// uint32_t gives us a max file size of 4 GiB - 1, while most neural networks are a few MiB in size
+				uint32_t weights_size;
+			};
+
+			/** The header used by version 2 bundles.  The first 16 bytes are never obfuscated.  When @ref kFlagObfuscated
+			 * is set, the section offsets and sizes are obfuscated the same way as the sections.
+			 */
+			struct HeadV2
+			{
+				uint8_t header[4];		///< @p "DH" followed by the major version @p 0 and the minor version @p 2.
+				uint32_t head_size;		///< Size of this structure, in bytes.
+				uint32_t alignment;		///< Each section starts on a multiple of this many bytes.  @p 4096, or @p 1 when obfuscated.
+				uint32_t flags;			///< Bit @p 0 is set when the sections are obfuscated.
+				uint64_t cfg_offset;
+				uint64_t cfg_size;
+				uint64_t names_offset;
+				uint64_t names_size;
+				uint64_t weights_offset;
+				uint64_t weights_size;
+			};
+			#pragma pack(pop)
+
+			/// Set in @ref HeadV2::flags when the sections are obfuscated.
+			static constexpr uint32_t kFlagObfuscated = 0x01;
+
+			/// The section alignment used when creating new bundles which are not obfuscated.  This matches the page size on most systems.
+			static constexpr uint32_t kAlignment = 4096;
+
+			/// The number of bytes at the start of @ref HeadV2 which are never obfuscated.
+			static constexpr size_t kPlainHeadSize = 16;
+
+			/** Constructor.  This opens and validates the bundle, but does not decode any of the sections.
+			 *
+			 * @param [in] filename The bundle file previously created by @ref DarkHelp::combine().
+			 * @param [in] key The key phrase used when the bundle was created.  Use an empty key if the bundle is not
+			 * obfuscated.
+			 */
+			Bundle(const std::filesystem::path & filename, const std::string & key = "");
+
+			/// Destructor.  Any @p std::string_view returned by this object is no longer valid once it has been destroyed.
+			~Bundle();
+
+			Bundle(const Bundle &) = delete;
+			Bundle & operator=(const Bundle &) = delete;
+
+			/// The bundle format version, either @p 1 or @p 2.
+			int version() const { return bundle_version; }
+
+			/// The @p .cfg file.
+			std::string_view cfg() { return get(cfg_section); }
+
+			/// The @p .names file.
+			std::string_view names() { return get(names_section); }
+
+			/// The @p .weights file.
+			std::string_view weights() { return get(weights_section); }
+
+		private:
+
+			struct Section
+			{
+				uint64_t offset		= 0;
+				uint64_t size		= 0;
+				std::unique_ptr<char[]> buffer;	///< Only used when the section needs to be decoded.
+			};
+
+			/// Return the given section, decoding it first if necessary.
+			std::string_view get(Section & section);
+
+			void unmap();
+
+			std::string obfuscation_key;
+			int bundle_version;
+
+			/// @{ The entire bundle file, memory-mapped as read-only.
+			const uint8_t * data;
+			size_t size;
+			#ifdef WIN32
+			void * file_handle;
+			void * mapping_handle;
+			#endif
+			/// @}
+
+			Section cfg_section;
+			Section names_section;
+			Section weights_section;
+	};
+}
@@ -65,6 +65,7 @@ DarkHelp::Config & DarkHelp::Config::reset()
 	annotation_pixelate_enabled			= false;
 	annotation_pixelate_size			= 15;
 	annotation_pixelate_classes			.clear();
+	annotation_pixelate_average			= false;
 	names_include_percentage			= true;
 	include_all_names					= true;
 	fix_out_of_bound_values				= true;
@@ -89,8 +90,10 @@ DarkHelp::Config & DarkHelp::Config::reset()
 	snapping_vertical_tolerance			= 5;
 	snapping_limit_shrink				= 0.4;
 	snapping_limit_grow					= 1.25;
+	snapping_lazy_binarization			= false;
 	redirect_darknet_output				= false; // don't default this to TRUE, it becomes too easy to hide errors!
 	use_fast_image_resize				= true;
+	use_letterbox						= false;
 
 	return *this;
 }
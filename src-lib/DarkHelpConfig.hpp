@@ -264,6 +264,18 @@ namespace DarkHelp
 			 */
 			std::set<int> annotation_pixelate_classes;
 
+			/** When set to @p true, each pixelation cell is filled with the average colour of the cell instead of the
+			 * dominant colour.  This uses @ref DarkHelp::pixelate_rectangles_average() which resizes each prediction with
+			 * @p cv::INTER_AREA and then back to the original size with @p cv::INTER_NEAREST, and is much faster than
+			 * looking for the dominant colour when there are many large predictions to pixelate, such as faces in 4K video.
+			 * Defaults to @p false.
+			 *
+			 * @see @ref DarkHelp::Config::annotation_pixelate_enabled
+			 *
+			 * @since 2026-10-16
+			 */
+			bool annotation_pixelate_average;
+
 			/** Darknet sometimes will return values that are out-of-bound, especially with objects near the edges of the image,
 			 * or when low detection thresholds.
 			 *
@@ -335,11 +347,15 @@ namespace DarkHelp
 			/** When training, the @p "batch=..." and @p "subdivisions=..." values in the .cfg file are typically set to a large
 			 * value.  But when loading a neural network for inference as %DarkHelp is designed to help with, @em both of those
 			 * values in the .cfg should be set to @p "1".  When @p modify_batch_and_subdivisions is enabled, %DarkHelp will edit
-			 * the configuration file once @ref DarkHelp::NN::init() is called.  This ensures the values are set as needed prior
+			 * the configuration once @ref DarkHelp::NN::init() is called.  This ensures the values are set as needed prior
 			 * to Darknet loading the .cfg file.
 			 *
-			 * The default value for @p modify_batch_and_subdivisions is @p true, meaning the .cfg file will be modified.  If set
-			 * to @p false, %DarkHelp will not modify the configuration file.
+			 * The changes are made to a copy of the configuration in memory.  The .cfg file on disk is never modified, so it
+			 * may be on a read-only filesystem, and several neural networks may be loaded from the same files at the same time.
+			 * (Prior to October 2026, the .cfg file on disk was re-written.)
+			 *
+			 * The default value for @p modify_batch_and_subdivisions is @p true, meaning the configuration will be modified.  If
+			 * set to @p false, %DarkHelp will not modify the configuration.
 			 *
 			 * Example use:
 			 *
@@ -562,6 +578,22 @@ namespace DarkHelp
 			 */
 			float snapping_limit_grow;
 
+			/** When snapping is enabled, this determines if the black-and-white binary image is created for the entire image,
+			 * or only for the areas which are needed to snap the annotations.  When set to @p true, the image is binarized in
+			 * tiles of 256x256 pixels the first time snapping needs to look at that part of the image, and the tiles are kept
+			 * until the next image is processed.  The results are identical either way, but on large images with only a few
+			 * predictions, such as scanned documents, this is much faster.
+			 *
+			 * When set to @p true, the parts of @ref DarkHelp::NN::binary_inverted_image which were not needed for snapping
+			 * are left black.  Default is @p false.
+			 *
+			 * @see @ref DarkHelp::Config::snapping_enabled
+			 * @see @ref DarkHelp::Config::binary_threshold_block_size
+			 *
+			 * @since 2026-10-16
+			 */
+			bool snapping_lazy_binarization;
+
 			/** Redirect Darknet output to @p /dev/null (Linux) or @p NUL: (Windows).
 			 *
 			 * Darknet by default generates a lot of output on both @p STDOUT and @p STDERR at startup.  When this option is set
@@ -577,9 +609,10 @@ namespace DarkHelp
 			bool redirect_darknet_output;
 
 			/** Determine if %DarkHelp should use a fast method of resizing images, or a slower but more accurate method.  By
-			 * default, the OpenCV @p cv::INTER_NEAREST method will be used.  This is faster, but the image quality may be
-			 * impacted.  If this is set to @p false, then %DarkHelp will use OpenCV's @p INTER_AREA or @p INTER_CUBIC, which
-			 * are slower but result in better images.
+			 * default, the image is resized with bilinear interpolation by @ref DarkHelp::fill_network_input() while it is
+			 * converted to the network input, or with @p cv::INTER_NEAREST on the GPU when OpenCV was built with CUDA.  This
+			 * is faster, but the image quality may be impacted.  If this is set to @p false, then %DarkHelp will use OpenCV's
+			 * @p INTER_AREA or @p INTER_CUBIC, which are slower but result in better images.
 			 *
 			 * For "real world" images, the default of @p true for this option is probably what you want.  If you are working
 			 * with documents that contain black-and-white text, or zoomed-in images such as close-ups of barcodes and components
@@ -587,9 +620,27 @@ namespace DarkHelp
 			 *
 			 * @see @ref DarkHelp::fast_resize_ignore_aspect_ratio()
 			 * @see @ref DarkHelp::slow_resize_ignore_aspect_ratio()
+			 * @see @ref DarkHelp::fill_network_input()
 			 *
 			 * @since 2023-07-08
 			 */
 			bool use_fast_image_resize;
+
+			/** Determine if images are letterboxed prior to inference.  When set to @p true, the image is resized to fit
+			 * within the network dimensions while keeping the original aspect ratio, centered, and the remaining area is
+			 * filled in with grey.  The coordinates returned by the neural network are then converted back to the original
+			 * image, so the prediction results are the same as when letterboxing is turned off.  This should be enabled if
+			 * the network was trained with letterboxed images.
+			 *
+			 * The image is resized directly into the network input kept by @ref DarkHelp::NN, which is re-used for
+			 * subsequent images, so letterboxing does not allocate a new image or make another copy.
+			 *
+			 * The default is @p false, meaning images are stretched to the network dimensions.
+			 *
+			 * @see @ref DarkHelp::Config::use_fast_image_resize
+			 *
+			 * @since 2026-10-16
+			 */
+			bool use_letterbox;
 	};
 }
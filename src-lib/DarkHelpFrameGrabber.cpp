@@ -0,0 +1,131 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#include "DarkHelpFrameGrabber.hpp"
+
+
+DarkHelp::FrameGrabber::FrameGrabber(cv::VideoCapture & capture) :
+	cap(capture),
+	stop_requested(false),
+	running(false),
+	total_frames_read(0),
+	total_frames_dropped(0),
+	total_read_errors(0)
+{
+	start();
+
+	return;
+}
+
+
+DarkHelp::FrameGrabber::~FrameGrabber()
+{
+	stop();
+
+	return;
+}
+
+
+DarkHelp::FrameGrabber & DarkHelp::FrameGrabber::start()
+{
+	if (thread.joinable() and not running)
+	{
+		// the previous thread has already exited on its own
+		thread.join();
+	}
+
+	if (not thread.joinable())
+	{
+		stop_requested	= false;
+		running			= true;
+		thread			= std::thread(&FrameGrabber::run, this);
+	}
+
+	return *this;
+}
+
+
+DarkHelp::FrameGrabber & DarkHelp::FrameGrabber::stop()
+{
+	stop_requested = true;
+
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+
+	if (true)
+	{
+		std::scoped_lock lock(latest_frame_lock);
+		latest_frame = cv::Mat();
+	}
+
+	return *this;
+}
+
+
+cv::Mat DarkHelp::FrameGrabber::get_latest_frame(const std::chrono::milliseconds & timeout)
+{
+	cv::Mat mat;
+
+	std::unique_lock lock(latest_frame_lock);
+	trigger.wait_for(lock, timeout, [&]{ return latest_frame.empty() == false or running == false; });
+
+	// take ownership of the frame so the same one isn't returned twice
+	std::swap(mat, latest_frame);
+
+	return mat;
+}
+
+
+void DarkHelp::FrameGrabber::run()
+{
+	try
+	{
+		while (not stop_requested and cap.isOpened())
+		{
+			// always read into a new cv::Mat since the caller may still be using the previous frame
+			cv::Mat mat;
+			cap.read(mat);
+
+			if (mat.empty())
+			{
+				total_read_errors ++;
+
+				// don't spin if the camera was disconnected
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				continue;
+			}
+
+			total_frames_read ++;
+
+			if (true)
+			{
+				std::scoped_lock lock(latest_frame_lock);
+				if (not latest_frame.empty())
+				{
+					// the previous frame was never retrieved, so it gets replaced by this newer frame
+					total_frames_dropped ++;
+				}
+				latest_frame = mat;
+			}
+
+			trigger.notify_all();
+		}
+	}
+	catch (const std::exception & e)
+	{
+		std::cout << "frame grabber caught exception: " << e.what() << std::endl;
+	}
+
+	if (true)
+	{
+		std::scoped_lock lock(latest_frame_lock);
+		running = false;
+	}
+	trigger.notify_all();
+
+	return;
+}
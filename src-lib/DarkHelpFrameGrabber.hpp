@@ -0,0 +1,121 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#pragma once
+
+#include "DarkHelp.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+/** @file
+ * %DarkHelp's class to read frames from a camera on a secondary thread.
+ */
+
+
+namespace DarkHelp
+{
+	/** This class reads frames from a @p cv::VideoCapture object on a dedicated thread, and only keeps the most recent
+	 * frame.  When reading directly from a camera on the same thread that runs inference, the time it takes to read each
+	 * frame is added to the time it takes to run inference.  And when inference is slower than the camera, the frames
+	 * pile up in the camera buffers, meaning the frames processed are no longer "live" but are instead several frames
+	 * old.
+	 *
+	 * With this class, frames are continuously read from the camera.  When a new frame is read before the previous one
+	 * was retrieved with @ref get_latest_frame(), the previous frame is discarded.  This way, inference always runs on
+	 * the most recent frame.  The number of frames read and dropped is tracked so the caller can determine whether the
+	 * neural network is able to keep up with the camera.
+	 *
+	 * @note This is meant for live cameras.  Do not use this with video files, since frames would be discarded.
+	 *
+	 * Note this header file is not included by @p DarkHelp.hpp.  To use this functionality you'll need to explicitely
+	 * include this header file.
+	 *
+	 * @since 2026-10-16
+	 */
+	class FrameGrabber final
+	{
+		public:
+
+			/** Constructor.  The thread used to read frames is immediately started.
+			 *
+			 * @param [in] capture An already-opened @p cv::VideoCapture object.  The caller retains ownership of this
+			 * object, and must ensure that it is not accessed by anything else while the @p FrameGrabber is running.
+			 */
+			FrameGrabber(cv::VideoCapture & capture);
+
+			/// Destructor.  This will stop the thread used to read frames.
+			~FrameGrabber();
+
+			/** Starts the thread used to read frames.  This is automatically called by the constructor, but may also be
+			 * called manually if @ref stop() was called.  Calling @p start() when the thread is already running has no
+			 * effect.
+			 */
+			FrameGrabber & start();
+
+			/** Stops the thread used to read frames.  Does not return until the thread has joined.  Once the thread has
+			 * stopped, the @p cv::VideoCapture object may once again be used directly by the caller.
+			 */
+			FrameGrabber & stop();
+
+			/** Get the most recent frame.  Each frame is only returned once, so if a new frame has not been read since the
+			 * last call, this will block until the next frame is available.
+			 *
+			 * @return An empty @p cv::Mat is returned if no frame becomes available within the given timeout, or if the
+			 * thread used to read frames is no longer running.
+			 *
+			 * @see @ref is_running()
+			 */
+			cv::Mat get_latest_frame(const std::chrono::milliseconds & timeout = std::chrono::milliseconds(1000));
+
+			/** Determines if the thread is still reading frames.  The thread will stop if the video capture object throws
+			 * an exception, or is no longer opened.
+			 */
+			bool is_running() const
+			{
+				return running;
+			}
+
+			/// The total number of frames successfully read from the camera.
+			size_t frames_read() const
+			{
+				return total_frames_read;
+			}
+
+			/// The total number of frames which were discarded because they were replaced by a more recent frame.
+			size_t frames_dropped() const
+			{
+				return total_frames_dropped;
+			}
+
+			/// The total number of times the camera failed to return a frame.
+			size_t read_errors() const
+			{
+				return total_read_errors;
+			}
+
+		private:
+
+			/// The method that runs on the secondary thread to read frames.  @see @ref start()
+			void run();
+
+			cv::VideoCapture & cap;
+			std::thread thread;
+			std::atomic<bool> stop_requested;
+			std::atomic<bool> running;
+
+			/// @{ The most recent frame, which has not yet been returned by @ref get_latest_frame().
+			cv::Mat latest_frame;
+			std::mutex latest_frame_lock;
+			std::condition_variable trigger;
+			/// @}
+
+			std::atomic<size_t> total_frames_read;
+			std::atomic<size_t> total_frames_dropped;
+			std::atomic<size_t> total_read_errors;
+	};
+}
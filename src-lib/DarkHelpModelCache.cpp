@@ -0,0 +1,319 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#include "DarkHelp.hpp"
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <mutex>
+
+
+namespace
+{
+	struct Cache
+	{
+		std::mutex lock;
+
+		/// All the models, keyed by the hash of their content.
+		std::map<uint64_t, std::weak_ptr<const DarkHelp::ModelCache::Model>> models;
+
+		/// The hash of the files previously loaded, keyed by the signature of those files.  @see @ref signature()
+		std::map<std::string, uint64_t> signatures;
+
+		/// The models which are currently being read by another thread, keyed by signature.  @see @ref find_or_load()
+		std::map<std::string, std::shared_future<DarkHelp::ModelCache::SPModel>> loading;
+	};
+
+
+	/// Use a function-local static so the cache is safe to use from the constructors of other static objects.
+	Cache & get_cache()
+	{
+		static Cache cache;
+
+		return cache;
+	}
+
+
+	/// Identify a file by name, size, and timestamp, so it can be found in the cache without reading the file.
+	std::string signature(const std::filesystem::path & filename)
+	{
+		if (filename.empty())
+		{
+			return "-";
+		}
+
+		if (not std::filesystem::is_regular_file(filename))
+		{
+			/// @throw std::invalid_argument if the file does not exist or is not a regular file.
+			throw std::invalid_argument("file does not exist or is not a regular file: " + filename.string());
+		}
+
+		const auto path = std::filesystem::canonical(filename);
+
+		return
+			path.string() + "|" +
+			std::to_string(std::filesystem::file_size(path)) + "|" +
+			std::to_string(std::filesystem::last_write_time(path).time_since_epoch().count());
+	}
+
+
+	std::string read_file(const std::filesystem::path & filename)
+	{
+		std::string content;
+
+		if (filename.empty())
+		{
+			return content;
+		}
+
+		std::ifstream ifs(filename, std::ifstream::in | std::ifstream::binary);
+		if (not ifs.is_open())
+		{
+			/// @throw std::runtime_error if the file cannot be read.
+			throw std::runtime_error("failed to read " + filename.string());
+		}
+
+		content.resize(std::filesystem::file_size(filename));
+		ifs.read(content.data(), content.size());
+		if (static_cast<size_t>(ifs.gcount()) != content.size())
+		{
+			throw std::runtime_error("failed to read " + filename.string());
+		}
+
+		return content;
+	}
+
+
+	/// The cache lock must already be held by the caller.
+	DarkHelp::ModelCache::SPModel find(Cache & cache, const std::string & key)
+	{
+		const auto iter = cache.signatures.find(key);
+		if (iter != cache.signatures.end())
+		{
+			const auto model_iter = cache.models.find(iter->second);
+			if (model_iter != cache.models.end())
+			{
+				return model_iter->second.lock();
+			}
+		}
+
+		return nullptr;
+	}
+
+
+	DarkHelp::ModelCache::SPModel insert(const std::string & key, std::shared_ptr<DarkHelp::ModelCache::Model> model)
+	{
+		model->hash = DarkHelp::ModelCache::hash(model->weights, DarkHelp::ModelCache::hash(model->names, DarkHelp::ModelCache::hash(model->cfg)));
+
+		auto & cache = get_cache();
+		std::scoped_lock lock(cache.lock);
+
+		// forget about models which are no longer used by anyone
+		for (auto iter = cache.models.begin(); iter != cache.models.end(); )
+		{
+			if (iter->second.expired())
+			{
+				iter = cache.models.erase(iter);
+			}
+			else
+			{
+				iter ++;
+			}
+		}
+		for (auto iter = cache.signatures.begin(); iter != cache.signatures.end(); )
+		{
+			if (cache.models.count(iter->second) == 0)
+			{
+				iter = cache.signatures.erase(iter);
+			}
+			else
+			{
+				iter ++;
+			}
+		}
+
+		cache.signatures[key] = model->hash;
+
+		// if identical content is already in the cache -- for example if another thread was loading the same files at the
+		// same time -- then keep the existing model and discard the new one
+		DarkHelp::ModelCache::SPModel result = cache.models[model->hash].lock();
+		if (not result)
+		{
+			result = model;
+			cache.models[model->hash] = result;
+		}
+
+		return result;
+	}
+
+
+	/** Get the model from the cache, or call @p reader to create it.  When several threads ask for the same model at the
+	 * same time, only the first one calls @p reader, and the others wait for it to finish instead of each reading the
+	 * same files.  If @p reader throws, the exception is re-thrown in all of the waiting threads.
+	 */
+	DarkHelp::ModelCache::SPModel find_or_load(const std::string & key, const std::function<std::shared_ptr<DarkHelp::ModelCache::Model>()> & reader)
+	{
+		auto & cache = get_cache();
+
+		std::promise<DarkHelp::ModelCache::SPModel> promise;
+		std::shared_future<DarkHelp::ModelCache::SPModel> future;
+		if (true)
+		{
+			std::scoped_lock lock(cache.lock);
+
+			auto result = find(cache, key);
+			if (result)
+			{
+				return result;
+			}
+
+			const auto iter = cache.loading.find(key);
+			if (iter != cache.loading.end())
+			{
+				future = iter->second;
+			}
+			else
+			{
+				cache.loading[key] = promise.get_future().share();
+			}
+		}
+
+		if (future.valid())
+		{
+			// another thread is already reading this model
+			return future.get();
+		}
+
+		auto forget_loading = [&]()
+		{
+			std::scoped_lock lock(cache.lock);
+			cache.loading.erase(key);
+		};
+
+		try
+		{
+			// the files are read without holding the lock since the weights may be several hundred MiB
+			auto result = insert(key, reader());
+			promise.set_value(result);
+			forget_loading();
+
+			return result;
+		}
+		catch (...)
+		{
+			promise.set_exception(std::current_exception());
+			forget_loading();
+			throw;
+		}
+	}
+}
+
+
+DarkHelp::ModelCache::SPModel DarkHelp::ModelCache::load(const std::filesystem::path & cfg_filename, const std::filesystem::path & weights_filename, const std::filesystem::path & names_filename)
+{
+	if (cfg_filename.empty() or weights_filename.empty())
+	{
+		/// @throw std::invalid_argument if the .cfg or .weights filenames have not been set.
+		throw std::invalid_argument("cannot load the network without a .cfg or .weights file");
+	}
+
+	const std::string key =
+		signature(cfg_filename		) + "\n" +
+		signature(weights_filename	) + "\n" +
+		signature(names_filename	);
+
+	return find_or_load(key, [&]()
+	{
+		auto model = std::make_shared<Model>();
+		model->cfg		= read_file(cfg_filename);
+		model->weights	= read_file(weights_filename);
+		model->names	= read_file(names_filename);
+
+		return model;
+	});
+}
+
+
+DarkHelp::ModelCache::SPModel DarkHelp::ModelCache::load(const std::filesystem::path & bundle_filename, const std::string & key)
+{
+	// the hash of the key is part of the signature so an incorrect key is never satisfied by the cache
+	const std::string signature_key = signature(bundle_filename) + "\n" + std::to_string(DarkHelp::ModelCache::hash(key));
+
+	return find_or_load(signature_key, [&]()
+	{
+		Bundle bundle(bundle_filename, key);
+
+		auto model = std::make_shared<Model>();
+		model->cfg		= bundle.cfg();
+		model->names	= bundle.names();
+		model->weights	= bundle.weights();
+
+		return model;
+	});
+}
+
+
+size_t DarkHelp::ModelCache::size()
+{
+	auto & cache = get_cache();
+	std::scoped_lock lock(cache.lock);
+
+	size_t count = 0;
+	for (const auto & [model_hash, model] : cache.models)
+	{
+		if (not model.expired())
+		{
+			count ++;
+		}
+	}
+
+	return count;
+}
+
+
+void DarkHelp::ModelCache::clear()
+{
+	auto & cache = get_cache();
+	std::scoped_lock lock(cache.lock);
+
+	cache.models.clear();
+	cache.signatures.clear();
+
+	return;
+}
+
+
+uint64_t DarkHelp::ModelCache::hash(const std::string_view data, uint64_t seed)
+{
+	// similar to FNV-1a but consumes 8 bytes at a time, since this is called on .weights files which can be hundreds of MiB
+	const uint64_t prime = 0x100000001b3ULL;
+
+	uint64_t h = seed ^ data.size();
+	const char * ptr = data.data();
+	size_t len = data.size();
+
+	while (len >= sizeof(uint64_t))
+	{
+		uint64_t word = 0;
+		std::memcpy(&word, ptr, sizeof(word));
+
+		h = (h ^ word) * prime;
+		h ^= h >> 32;
+
+		ptr += sizeof(word);
+		len -= sizeof(word);
+	}
+
+	while (len > 0)
+	{
+		h = (h ^ static_cast<uint8_t>(*ptr)) * prime;
+
+		ptr ++;
+		len --;
+	}
+
+	return h;
+}
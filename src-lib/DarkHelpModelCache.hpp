@@ -0,0 +1,87 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#pragma once
+
+#include "DarkHelp.hpp"
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+
+/** @file
+ * %DarkHelp's process-wide cache of neural network files.
+ */
+
+
+namespace DarkHelp
+{
+	/** A process-wide cache of the @p .cfg, @p .names, and @p .weights files used to load neural networks.  Once a neural
+	 * network has been read from disk (or decoded from a bundle), the same copy in memory is shared by everything in the
+	 * process which loads that network, such as each of the worker threads in @ref DHThreads, without reading or decoding
+	 * the files again.  Pass the cached files to @ref DarkHelp::NN::init_from_memory() to load the neural network.
+	 *
+	 * Models are keyed by a hash of their content, so the same network loaded from different files or from a bundle is
+	 * only kept once in memory.  The filenames, sizes, and timestamps of the files are also remembered, meaning files
+	 * which have not changed are not read or hashed a second time.  If several threads ask for the same model at the same
+	 * time, the files are only read once while the other threads wait for the result.
+	 *
+	 * Models remain in the cache for as long as something references the @ref SPModel returned by @ref load().  This
+	 * means memory is released once the last user of a model goes away, and there is no need to call @ref clear().
+	 *
+	 * @note Darknet and OpenCV both parse the network into their own structures which cannot be shared between
+	 * instances of @ref DarkHelp::NN, so this caches the files and not the parsed network.
+	 *
+	 * All methods are static and thread-safe.
+	 *
+	 * @since 2026-10-16
+	 */
+	class ModelCache final
+	{
+		public:
+
+			/// The content of the files needed to load a neural network.
+			struct Model
+			{
+				uint64_t hash;			///< Hash of the @p .cfg, @p .names, and @p .weights content.  @see @ref hash()
+				std::string cfg;		///< The content of the @p .cfg file.
+				std::string names;		///< The content of the @p .names file.  This is empty if there are no names.
+				std::string weights;	///< The content of the @p .weights file.
+			};
+
+			/// Models are shared and must never be modified once they are in the cache.
+			using SPModel = std::shared_ptr<const Model>;
+
+			ModelCache() = delete;
+
+			/** Get the neural network from the cache, reading the files from disk if the cache does not already have them.
+			 *
+			 * @param [in] cfg_filename The @p .cfg file.
+			 * @param [in] weights_filename The @p .weights file.
+			 * @param [in] names_filename The @p .names file.  This may be empty.
+			 */
+			static SPModel load(const std::filesystem::path & cfg_filename, const std::filesystem::path & weights_filename, const std::filesystem::path & names_filename);
+
+			/** Get the neural network from the cache, decoding the bundle if the cache does not already have it.
+			 *
+			 * @param [in] bundle_filename The bundle file previously created by @ref DarkHelp::combine().
+			 * @param [in] key The key phrase used when the bundle was created.
+			 *
+			 * @see @ref DarkHelp::Bundle
+			 */
+			static SPModel load(const std::filesystem::path & bundle_filename, const std::string & key);
+
+			/// Get the number of models currently in the cache.
+			static size_t size();
+
+			/** Forget about all the models.  Models which are still in use are not freed until they are no longer
+			 * referenced, but they will not be returned by subsequent calls to @ref load().
+			 */
+			static void clear();
+
+			/// The 64-bit hash used to identify models.  This is only used to detect identical content, it is not secure.
+			static uint64_t hash(const std::string_view data, uint64_t seed = 0xcbf29ce484222325ULL);
+	};
+}
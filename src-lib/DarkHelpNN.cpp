@@ -10,6 +10,7 @@
 
 #include <fstream>
 #include <regex>
+#include <sstream>
 #include <cmath>
 #include <ctime>
 #include <sys/stat.h>
@@ -41,6 +42,232 @@
  */
 #include <darknet.h>
 
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <random>
+
+#ifdef WIN32
+#include <io.h>		// _wopen()
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>	// memfd_create()
+#endif
+
+
+namespace
+{
+	/** Darknet can only load a neural network from files.  This gives Darknet a "file" with the given content.  On Linux
+	 * the file only exists in memory.  On other platforms a temporary file is created, and deleted in the destructor.
+	 */
+	class MemoryFile final
+	{
+		public:
+
+			MemoryFile(const std::string & extension, const std::string_view data) :
+				fd(-1)
+			{
+				#ifdef __linux__
+				fd = memfd_create(("darkhelp" + extension).c_str(), MFD_CLOEXEC);
+				if (fd >= 0)
+				{
+					size_t offset = 0;
+					while (offset < data.size())
+					{
+						const auto rc = write(fd, data.data() + offset, data.size() - offset);
+						if (rc < 0 and errno == EINTR)
+						{
+							continue;
+						}
+						if (rc <= 0)
+						{
+							close(fd);
+							throw std::runtime_error("failed to write " + extension + " to memory");
+						}
+						offset += rc;
+					}
+
+					filename = "/proc/self/fd/" + std::to_string(fd);
+					return;
+				}
+				#endif
+
+				/* If we get here then we need to use a real file.  Several threads (or processes) may be loading a network
+				 * at the same time, so the file is created exclusively, and we try again with a new name if it exists.
+				 */
+				static std::atomic<uint64_t> counter(0);
+				thread_local std::mt19937_64 rng(std::random_device{}());
+				const auto tmp = std::filesystem::temp_directory_path();
+				for (int attempt = 0; ; attempt ++)
+				{
+					std::stringstream ss;
+					ss << "darkhelp_" << std::hex << rng() << "_" << counter ++ << extension;
+					tmp_path = tmp / ss.str();
+
+					#ifdef WIN32
+					const int tmp_fd = _wopen(tmp_path.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY, _S_IREAD | _S_IWRITE);
+					#else
+					const int tmp_fd = open(tmp_path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0600);
+					#endif
+					if (tmp_fd >= 0)
+					{
+						// the name now belongs to us, so the file can be re-opened and written with a normal stream
+						#ifdef WIN32
+						_close(tmp_fd);
+						#else
+						close(tmp_fd);
+						#endif
+						break;
+					}
+
+					if (errno != EEXIST or attempt >= 100)
+					{
+						throw std::runtime_error("failed to create " + tmp_path.string() + " (errno=" + std::to_string(errno) + ")");
+					}
+				}
+
+				std::ofstream ofs(tmp_path, std::ofstream::binary | std::ofstream::trunc);
+				ofs.write(data.data(), data.size());
+				if (not ofs.good())
+				{
+					std::error_code ec;
+					std::filesystem::remove(tmp_path, ec);
+					throw std::runtime_error("failed to write " + tmp_path.string());
+				}
+
+				filename = tmp_path.string();
+
+				return;
+			}
+
+			~MemoryFile()
+			{
+				#ifdef __linux__
+				if (fd >= 0)
+				{
+					close(fd);
+				}
+				#endif
+
+				if (not tmp_path.empty())
+				{
+					std::error_code ec;
+					std::filesystem::remove(tmp_path, ec);
+				}
+
+				return;
+			}
+
+			/// The name to pass to Darknet.
+			std::string filename;
+
+		private:
+
+			int fd;
+			std::filesystem::path tmp_path;
+	};
+
+
+	/** Integral image of part of @ref DarkHelp::NN::binary_inverted_image, used when snapping to find the bounding
+	 * rectangle of the non-zero pixels within a region.  Each count is 4 lookups, so each edge of the rectangle is found
+	 * with a binary search instead of looking at every pixel in the region.
+	 */
+	class NonZeroFinder final
+	{
+		public:
+
+			/// The area of the image covered by the integral image.
+			cv::Rect window;
+
+			/// Build the integral image for the given window.  The window must already be binarized.
+			void reset(const cv::Mat & binary_inverted_image, const cv::Rect & new_window)
+			{
+				window = new_window;
+
+				// convert 255 to 1 so the sums are pixel counts and cannot overflow
+				cv::Mat ones;
+				cv::threshold(binary_inverted_image(window), ones, 0, 1, cv::THRESH_BINARY);
+				cv::integral(ones, sums, CV_32S);
+
+				return;
+			}
+
+			/** Get the bounding rectangle of the non-zero pixels within the region, which must be within the window.  This
+			 * returns the same thing as calling @p cv::findNonZero() and @p cv::boundingRect() on the region, including the
+			 * empty rectangle at the top-left of the region when there are no non-zero pixels.
+			 */
+			cv::Rect bounding_rect(const cv::Rect & roi) const
+			{
+				const int x0 = roi.x - window.x;
+				const int y0 = roi.y - window.y;
+				const int x1 = x0 + roi.width;
+				const int y1 = y0 + roi.height;
+
+				if (roi.empty() or count(x0, y0, x1, y1) == 0)
+				{
+					return cv::Rect(roi.x, roi.y, 0, 0);
+				}
+
+				// first row which has a non-zero pixel:  the smallest "t" for which rows [y0, t] are not all zero
+				int lo = y0;
+				int hi = y1 - 1;
+				while (lo < hi)
+				{
+					const int mid = lo + (hi - lo) / 2;
+					if (count(x0, y0, x1, mid + 1) > 0) hi = mid; else lo = mid + 1;
+				}
+				const int top = lo;
+
+				// last row which has a non-zero pixel
+				lo = top;
+				hi = y1 - 1;
+				while (lo < hi)
+				{
+					const int mid = lo + (hi - lo + 1) / 2;
+					if (count(x0, mid, x1, y1) > 0) lo = mid; else hi = mid - 1;
+				}
+				const int bottom = lo;
+
+				// first column which has a non-zero pixel
+				lo = x0;
+				hi = x1 - 1;
+				while (lo < hi)
+				{
+					const int mid = lo + (hi - lo) / 2;
+					if (count(x0, top, mid + 1, bottom + 1) > 0) hi = mid; else lo = mid + 1;
+				}
+				const int left = lo;
+
+				// last column which has a non-zero pixel
+				lo = left;
+				hi = x1 - 1;
+				while (lo < hi)
+				{
+					const int mid = lo + (hi - lo + 1) / 2;
+					if (count(mid, top, x1, bottom + 1) > 0) lo = mid; else hi = mid - 1;
+				}
+				const int right = lo;
+
+				return cv::Rect(window.x + left, window.y + top, right - left + 1, bottom - top + 1);
+			}
+
+		private:
+
+			/// Number of non-zero pixels in columns [x0, x1) and rows [y0, y1), relative to the window.
+			int count(const int x0, const int y0, const int x1, const int y1) const
+			{
+				return
+					sums.at<int>(y1, x1) - sums.at<int>(y0, x1) -
+					sums.at<int>(y1, x0) + sums.at<int>(y0, x0);
+			}
+
+			cv::Mat sums;
+	};
+}
+
 
 DarkHelp::NN::~NN()
 {
@@ -139,16 +366,8 @@ DarkHelp::NN::NN(const bool delete_combined_bundle_once_loaded, const std::strin
 
 DarkHelp::NN & DarkHelp::NN::init(const bool delete_combined_bundle_once_loaded, const std::string & filename, const std::string & key, const EDriver driver)
 {
-	std::filesystem::path cfg_filename;
-	std::filesystem::path names_filename;
-	std::filesystem::path weights_filename;
-
 	auto cleanup = [&]()
 	{
-		if (not cfg_filename	.empty()) std::filesystem::remove(cfg_filename);
-		if (not names_filename	.empty()) std::filesystem::remove(names_filename);
-		if (not weights_filename.empty()) std::filesystem::remove(weights_filename);
-
 		if (delete_combined_bundle_once_loaded)
 		{
 			std::filesystem::remove(filename);
@@ -157,9 +376,15 @@ DarkHelp::NN & DarkHelp::NN::init(const bool delete_combined_bundle_once_loaded,
 
 	try
 	{
-		DarkHelp::extract(key, filename, cfg_filename, names_filename, weights_filename);
-		init(cfg_filename.string(), weights_filename.string(), names_filename.string(), false, driver);
+		if (true)
+		{
+			// the bundle is memory-mapped and passed directly to Darknet or OpenCV, so nothing is extracted to disk
+			Bundle bundle(filename, key);
 
+			init_from_memory(bundle.cfg(), bundle.names(), bundle.weights(), driver);
+		}
+
+		// on Windows the bundle cannot be deleted until it has been unmapped
 		cleanup();
 	}
 	catch (...)
@@ -206,6 +431,67 @@ DarkHelp::NN & DarkHelp::NN::init()
 		throw std::invalid_argument("cannot initialize the network without a .cfg or .weights file");
 	}
 
+	// read the .cfg file once; any changes are made to the copy in memory, never to the file on disk
+	std::ifstream cfg_ifs(config.cfg_filename, std::ifstream::in | std::ifstream::binary);
+	if (not cfg_ifs.is_open())
+	{
+		/// @throw std::invalid_argument if the .cfg file cannot be opened.
+		throw std::invalid_argument("failed to open the configuration file " + config.cfg_filename);
+	}
+	std::string cfg((std::istreambuf_iterator<char>(cfg_ifs)), std::istreambuf_iterator<char>());
+	cfg_ifs.close();
+
+	const size_t number_of_changed_lines = apply_cfg_overrides(cfg);
+
+	if (config.driver < EDriver::kMin or
+		config.driver > EDriver::kMax)
+	{
+		config.driver = EDriver::kDarknet;
+	}
+
+	const auto t1 = std::chrono::high_resolution_clock::now();
+	if (true)
+	{
+		// if the .cfg was modified, then the loaders are given a copy which only exists in memory
+		std::unique_ptr<MemoryFile> cfg_file;
+		if (number_of_changed_lines > 0)
+		{
+			cfg_file.reset(new MemoryFile(".cfg", cfg));
+		}
+		const std::string & cfg_filename = (cfg_file ? cfg_file->filename : config.cfg_filename);
+
+		if (config.driver == EDriver::kDarknet)
+		{
+			load_darknet_network(cfg_filename, config.weights_filename);
+		}
+#if CV_VERSION_MAJOR >= 4 && defined(HAVE_OPENCV_DNN_OBJDETECT)
+		else
+		{
+			opencv_net = cv::dnn::readNetFromDarknet(cfg_filename, config.weights_filename);
+			select_opencv_backend();
+		}
+#endif
+	}
+
+	if (not config.names_filename.empty())
+	{
+		std::ifstream ifs(config.names_filename);
+		load_names(ifs, config.names_filename);
+	}
+
+	std::istringstream cfg_stream(cfg);
+	load_network_dimensions(cfg_stream, config.cfg_filename);
+
+	finish_init(t1);
+
+	return *this;
+}
+
+
+size_t DarkHelp::NN::apply_cfg_overrides(std::string & cfg)
+{
+	size_t number_of_changed_lines = 0;
+
 	if (config.modify_batch_and_subdivisions)
 	{
 		const MStr m =
@@ -213,15 +499,43 @@ DarkHelp::NN & DarkHelp::NN::init()
 			{"batch"		, "1"},
 			{"subdivisions"	, "1"}
 		};
-		edit_cfg_file(config.cfg_filename, m);
+		number_of_changed_lines = edit_cfg_text(cfg, m);
 
 		// do not combine this settings with the previous two since there is code that
 		// needs to behave differently when only the batch+subdivisions are modified
 		//
 		// 2021-04-08:  It looks like use_cuda_graph _may_ be causing problems.  Don't explicitely set it in DarkHelp.
-		//		edit_cfg_file(cfg_fn, {{"use_cuda_graph", "1"}});
+		//		edit_cfg_text(cfg, {{"use_cuda_graph", "1"}});
+	}
+
+	return number_of_changed_lines;
+}
+
+
+DarkHelp::NN & DarkHelp::NN::init_from_memory(const std::string_view cfg_data, const std::string_view names_data, const std::string_view weights, const EDriver d)
+{
+	if (cfg_data.empty() or weights.empty())
+	{
+		/// @throw std::invalid_argument if the .cfg or .weights are empty.
+		throw std::invalid_argument("cannot initialize the network without a .cfg or .weights file");
 	}
 
+	// there are no files, and any previous filenames no longer apply to this neural network
+	config.cfg_filename		.clear();
+	config.weights_filename	.clear();
+	config.names_filename	.clear();
+
+	#ifndef HAVE_OPENCV_DNN_OBJDETECT
+		// with old versions of OpenCV, we don't have a DNN module
+		config.driver = DarkHelp::EDriver::kDarknet;
+	#else
+		config.driver = d;
+	#endif
+
+	// the overrides are applied to a copy of the .cfg, the caller's buffer is never modified
+	std::string cfg(cfg_data);
+	apply_cfg_overrides(cfg);
+
 	if (config.driver < EDriver::kMin or
 		config.driver > EDriver::kMax)
 	{
@@ -231,99 +545,125 @@ DarkHelp::NN & DarkHelp::NN::init()
 	const auto t1 = std::chrono::high_resolution_clock::now();
 	if (config.driver == EDriver::kDarknet)
 	{
-		// The calls we make into darknet are based on what was found in test_detector() from src/detector.c.
+		// Darknet can only load from files, so give it files which only exist in memory
+		const MemoryFile cfg_file(".cfg", cfg);
+		const MemoryFile weights_file(".weights", weights);
+		load_darknet_network(cfg_file.filename, weights_file.filename);
+	}
+#if CV_VERSION_MAJOR >= 4 && defined(HAVE_OPENCV_DNN_OBJDETECT)
+	else
+	{
+		opencv_net = cv::dnn::readNetFromDarknet(cfg.data(), cfg.size(), weights.data(), weights.size());
+		select_opencv_backend();
+	}
+#endif
 
-		if (config.redirect_darknet_output)
-		{
-			toggle_output_redirection();
-		}
+	std::istringstream names_stream{std::string(names_data)};
+	load_names(names_stream, "the .names file");
 
-		darknet_net = load_network_custom(const_cast<char*>(config.cfg_filename.c_str()), const_cast<char*>(config.weights_filename.c_str()), 1, 1);
+	std::istringstream cfg_stream(cfg);
+	load_network_dimensions(cfg_stream, "the .cfg file");
 
-		if (config.redirect_darknet_output)
-		{
-			toggle_output_redirection();
-		}
+	finish_init(t1);
 
-		if (darknet_net == nullptr)
-		{
-			/// @throw std::runtime_error if the call to darknet's @p load_network_custom() has failed.
-			throw std::runtime_error("darknet failed to load the configuration, the weights, or both");
-		}
+	return *this;
+}
 
-		Darknet::NetworkPtr nw = reinterpret_cast<Darknet::NetworkPtr>(darknet_net);
 
-		// what does this call do?
-		calculate_binary_weights(nw);
+void DarkHelp::NN::load_darknet_network(const std::string & cfg_filename, const std::string & weights_filename)
+{
+	// The calls we make into darknet are based on what was found in test_detector() from src/detector.c.
+
+	if (config.redirect_darknet_output)
+	{
+		toggle_output_redirection();
 	}
-#if CV_VERSION_MAJOR >= 4 && defined(HAVE_OPENCV_DNN_OBJDETECT)
-	else
+
+	darknet_net = load_network_custom(const_cast<char*>(cfg_filename.c_str()), const_cast<char*>(weights_filename.c_str()), 1, 1);
+
+	if (config.redirect_darknet_output)
 	{
-		opencv_net = cv::dnn::readNetFromDarknet(config.cfg_filename, config.weights_filename);
+		toggle_output_redirection();
+	}
+
+	if (darknet_net == nullptr)
+	{
+		/// @throw std::runtime_error if the call to darknet's @p load_network_custom() has failed.
+		throw std::runtime_error("darknet failed to load the configuration, the weights, or both");
+	}
+
+	Darknet::NetworkPtr nw = reinterpret_cast<Darknet::NetworkPtr>(darknet_net);
+
+	// what does this call do?
+	calculate_binary_weights(nw);
+
+	return;
+}
 
+
+void DarkHelp::NN::select_opencv_backend()
+{
+#if CV_VERSION_MAJOR >= 4 && defined(HAVE_OPENCV_DNN_OBJDETECT)
 #if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 2)
-		if (config.driver == EDriver::kOpenCVCPU)
-		{
-			opencv_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-			opencv_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
-		}
-		else
-		{
-			opencv_net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
-			opencv_net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
-		}
-#else
+	if (config.driver == EDriver::kOpenCVCPU)
+	{
 		opencv_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
 		opencv_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
-#endif
 	}
+	else
+	{
+		opencv_net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
+		opencv_net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
+	}
+#else
+	opencv_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+	opencv_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+#endif
 #endif
 
-	if (not config.names_filename.empty())
-	{
-		std::ifstream ifs(config.names_filename);
-		std::string line;
-		while (std::getline(ifs, line))
-		{
-			// truncate leading/trailing whitespace
-			// (helps deal with CRLF when .names was edited on Windows)
+	return;
+}
 
-			auto p = line.find_last_not_of(" \t\r\n");
-			if (p != std::string::npos)
-			{
-				line.erase(p + 1);
-			}
 
-			p = line.find_first_not_of(" \t\r\n");
-			if (p == std::string::npos)
-			{
-				/// @throw std::invalid_argument if there is a blank line in the .names file.
-				throw std::runtime_error("unexpected blank line detected at " + config.names_filename + " line #" + std::to_string(names.size() + 1));
-			}
-			line.erase(0, p);
+void DarkHelp::NN::load_names(std::istream & is, const std::string & source)
+{
+	std::string line;
+	while (std::getline(is, line))
+	{
+		// truncate leading/trailing whitespace
+		// (helps deal with CRLF when .names was edited on Windows)
 
-			names.push_back(line);
+		auto p = line.find_last_not_of(" \t\r\n");
+		if (p != std::string::npos)
+		{
+			line.erase(p + 1);
 		}
-	}
 
-	// see which classes need to be suppressed (https://github.com/AlexeyAB/darknet/issues/2122)
-	for (size_t i = 0; i < names.size(); i ++)
-	{
-		if (names.at(i).find("dont_show") == 0)
+		p = line.find_first_not_of(" \t\r\n");
+		if (p == std::string::npos)
 		{
-			config.annotation_suppress_classes.insert(i);
+			/// @throw std::invalid_argument if there is a blank line in the .names file.
+			throw std::runtime_error("unexpected blank line detected at " + source + " line #" + std::to_string(names.size() + 1));
 		}
+		line.erase(0, p);
+
+		names.push_back(line);
 	}
 
+	return;
+}
+
+
+void DarkHelp::NN::load_network_dimensions(std::istream & is, const std::string & source)
+{
 	// cache the network network_dimensions (read the "width" and "height" from the .cfg file)
 	network_dimensions = cv::Size(0, 0);
 	number_of_channels = -1;
 	const std::regex rx("^\\s*(channels|width|height)\\s*=\\s*(\\d+)");
-	std::ifstream ifs(config.cfg_filename);
-	while (ifs.good() and (network_dimensions.area() <= 0 or number_of_channels <= 0))
+	while (is.good() and (network_dimensions.area() <= 0 or number_of_channels <= 0))
 	{
 		std::string line;
-		std::getline(ifs, line);
+		std::getline(is, line);
 		std::smatch sm;
 		if (std::regex_search(line, sm, rx))
 		{
@@ -347,13 +687,28 @@ DarkHelp::NN & DarkHelp::NN::init()
 	if (network_dimensions.area() <= 0)
 	{
 		/// @throw std::invalid_argument if the network dimensions cannot be read from the .cfg file
-		throw std::invalid_argument("failed to read the network width or height from " + config.cfg_filename);
+		throw std::invalid_argument("failed to read the network width or height from " + source);
 	}
 
 	if (number_of_channels != 1 and number_of_channels != 3)
 	{
 		/// @throw std::invalid_argument if the @p channels=... line in the .cfg file is not 1 or 3
-		throw std::invalid_argument("invalid number of channels in " + config.cfg_filename);
+		throw std::invalid_argument("invalid number of channels in " + source);
+	}
+
+	return;
+}
+
+
+void DarkHelp::NN::finish_init(const std::chrono::high_resolution_clock::time_point & t1)
+{
+	// see which classes need to be suppressed (https://github.com/AlexeyAB/darknet/issues/2122)
+	for (size_t i = 0; i < names.size(); i ++)
+	{
+		if (names.at(i).find("dont_show") == 0)
+		{
+			config.annotation_suppress_classes.insert(i);
+		}
 	}
 
 	// OpenCV's construction uses lazy initialization, and doesn't actually happen until we call into it.
@@ -378,7 +733,7 @@ DarkHelp::NN & DarkHelp::NN::init()
 	const auto t2 = std::chrono::high_resolution_clock::now();
 	duration = t2 - t1;
 
-	return *this;
+	return;
 }
 
 
@@ -411,6 +766,7 @@ DarkHelp::NN & DarkHelp::NN::clear()
 	prediction_results		.clear();
 	original_image			= cv::Mat();
 	binary_inverted_image	= cv::Mat();
+	binarized_tiles			= cv::Mat();
 	annotated_image			= cv::Mat();
 	horizontal_tiles		= 1;
 	vertical_tiles			= 1;
@@ -477,6 +833,45 @@ DarkHelp::PredictionResults DarkHelp::NN::predict(cv::Mat mat, const float new_t
 }
 
 
+DarkHelp::PredictionResults DarkHelp::NN::predict_tensor(const cv::Mat & tensor, cv::Mat image, const float new_threshold)
+{
+	const size_t expected_size = static_cast<size_t>(number_of_channels) * static_cast<size_t>(network_dimensions.area());
+
+	if (tensor.empty() or tensor.depth() != CV_32F or tensor.channels() != 1 or not tensor.isContinuous() or tensor.total() != expected_size)
+	{
+		/// @throw std::invalid_argument if the tensor does not match the network dimensions and channels.
+		throw std::invalid_argument(
+			"the tensor must be continuous CV_32F with " +
+			std::to_string(number_of_channels) + "x" +
+			std::to_string(network_dimensions.height) + "x" +
+			std::to_string(network_dimensions.width) + " values");
+	}
+
+	if (image.empty())
+	{
+		image = cv::Mat(network_dimensions, (number_of_channels == 1 ? CV_8UC1 : CV_8UC3), cv::Scalar::all(0));
+	}
+
+	// OpenCV DNN needs a 4D blob, which is only a different header around the same values
+	const int sizes[] = {1, number_of_channels, network_dimensions.height, network_dimensions.width};
+	external_network_input = tensor.reshape(1, 4, sizes);
+
+	try
+	{
+		predict_internal(image, new_threshold);
+	}
+	catch (...)
+	{
+		external_network_input = cv::Mat();
+		throw;
+	}
+
+	external_network_input = cv::Mat();
+
+	return prediction_results;
+}
+
+
 #ifdef DARKHELP_CAN_INCLUDE_DARKNET
 DarkHelp::PredictionResults DarkHelp::NN::predict(image img, const float new_threshold)
 {
@@ -719,36 +1114,80 @@ DarkHelp::PredictionResults DarkHelp::NN::predict_tile(cv::Mat mat, const float
 		}
 	}
 
-	if (config.enable_debug)
+	if (config.enable_debug)
+	{
+		// draw vertical lines to show the tiles
+		for (float x=1.0; x < horizontal_tiles_count; x++)
+		{
+			const int x_pos = std::round(mat.cols / horizontal_tiles_count * x);
+			cv::line(mat, cv::Point(x_pos, 0), cv::Point(x_pos, mat.rows), {255, 0, 0});
+		}
+
+		// draw horizontal lines to show the tiles
+		for (float y=1.0; y < vertical_tiles_count; y++)
+		{
+			const int y_pos = std::round(mat.rows / vertical_tiles_count * y);
+			cv::line(mat, cv::Point(0, y_pos), cv::Point(mat.cols, y_pos), {255, 0, 0});
+		}
+	}
+
+	original_image			= mat;
+	binary_inverted_image	= cv::Mat();
+	binarized_tiles			= cv::Mat();
+	prediction_results		= results;
+	duration				= total_duration;
+	horizontal_tiles		= horizontal_tiles_count;
+	vertical_tiles			= vertical_tiles_count;
+	tile_size				= new_tile_size;
+
+	return results;
+}
+
+
+cv::Mat DarkHelp::NN::annotate(const float new_threshold)
+{
+	if (original_image.empty())
+	{
+		/// @throw std::logic_error if an attempt is made to annotate an empty image
+		throw std::logic_error("cannot annotate an empty image; must call predict() first");
+	}
+
+	if (new_threshold >= 0.0)
+	{
+		config.threshold = new_threshold;
+	}
+
+	annotated_image = original_image.clone();
+
+	render_annotations(annotated_image);
+
+	return annotated_image;
+}
+
+
+cv::Mat & DarkHelp::NN::annotate_into(cv::Mat & output, const float new_threshold)
+{
+	if (original_image.empty())
 	{
-		// draw vertical lines to show the tiles
-		for (float x=1.0; x < horizontal_tiles_count; x++)
-		{
-			const int x_pos = std::round(mat.cols / horizontal_tiles_count * x);
-			cv::line(mat, cv::Point(x_pos, 0), cv::Point(x_pos, mat.rows), {255, 0, 0});
-		}
+		/// @throw std::logic_error if an attempt is made to annotate an empty image
+		throw std::logic_error("cannot annotate an empty image; must call predict() first");
+	}
 
-		// draw horizontal lines to show the tiles
-		for (float y=1.0; y < vertical_tiles_count; y++)
-		{
-			const int y_pos = std::round(mat.rows / vertical_tiles_count * y);
-			cv::line(mat, cv::Point(0, y_pos), cv::Point(mat.cols, y_pos), {255, 0, 0});
-		}
+	if (new_threshold >= 0.0)
+	{
+		config.threshold = new_threshold;
 	}
 
-	original_image			= mat;
-	binary_inverted_image	= cv::Mat();
-	prediction_results		= results;
-	duration				= total_duration;
-	horizontal_tiles		= horizontal_tiles_count;
-	vertical_tiles			= vertical_tiles_count;
-	tile_size				= new_tile_size;
+	// copyTo() only re-allocates when the output doesn't already have the right size and type
+	original_image.copyTo(output);
 
-	return results;
+	render_annotations(output);
+
+	return output;
 }
 
 
-cv::Mat DarkHelp::NN::annotate(const float new_threshold)
+cv::Mat & DarkHelp::NN::annotate_in_place(cv::Mat & image, const float new_threshold)
 {
 	if (original_image.empty())
 	{
@@ -756,16 +1195,36 @@ cv::Mat DarkHelp::NN::annotate(const float new_threshold)
 		throw std::logic_error("cannot annotate an empty image; must call predict() first");
 	}
 
+	if (image.size() != original_image.size())
+	{
+		/// @throw std::invalid_argument if the image is not the same size as the one used with predict()
+		throw std::invalid_argument("cannot annotate in-place since the image size does not match the image given to predict()");
+	}
+
 	if (new_threshold >= 0.0)
 	{
 		config.threshold = new_threshold;
 	}
 
-	annotated_image = original_image.clone();
+	render_annotations(image);
+
+	return image;
+}
+
 
+void DarkHelp::NN::render_annotations(cv::Mat & output)
+{
 	if (config.annotation_pixelate_enabled)
 	{
-		pixelate_rectangles(original_image, annotated_image, prediction_results, config.annotation_pixelate_classes, config.annotation_pixelate_size);
+		// the output is both the source and the destination so this works the same when annotating in-place
+		if (config.annotation_pixelate_average)
+		{
+			pixelate_rectangles_average(output, output, prediction_results, config.annotation_pixelate_classes, config.annotation_pixelate_size);
+		}
+		else
+		{
+			pixelate_rectangles(output, output, prediction_results, config.annotation_pixelate_classes, config.annotation_pixelate_size);
+		}
 	}
 
 	// make sure we always have colours we can use
@@ -774,75 +1233,147 @@ cv::Mat DarkHelp::NN::annotate(const float new_threshold)
 		config.annotation_colours = get_default_annotation_colours();
 	}
 
-	for (const auto & pred : prediction_results)
+	std::vector<const PredictionResult *> visible;
+	if (config.annotation_line_thickness > 0)
 	{
-		if (config.annotation_suppress_classes.count(pred.best_class) != 0)
+		visible.reserve(prediction_results.size());
+		for (const auto & pred : prediction_results)
 		{
-			continue;
+			if (config.annotation_suppress_classes.count(pred.best_class) == 0 and pred.best_probability >= config.threshold)
+			{
+				visible.push_back(&pred);
+			}
 		}
+	}
+
+	const cv::Rect image_rect(0, 0, output.cols, output.rows);
 
-		if (config.annotation_line_thickness > 0 and pred.best_probability >= config.threshold)
+	if (config.annotation_shade_predictions > 0.0 and config.annotation_shade_predictions < 1.0 and not visible.empty())
+	{
+		// shade all the rectangles at once by drawing them onto a copy of the area they cover and blending it back
+		cv::Rect area;
+		for (const auto pred : visible)
 		{
-			const auto colour = config.annotation_colours[pred.best_class % config.annotation_colours.size()];
+			area |= (pred->rect & image_rect);
+		}
 
-			int line_thickness_or_fill = config.annotation_line_thickness;
-			if (config.annotation_shade_predictions >= 1.0)
-			{
-				line_thickness_or_fill = CV_FILLED;
-			}
-			else if (config.annotation_shade_predictions > 0.0)
+		if (not area.empty())
+		{
+			cv::Mat roi = output(area);
+			cv::Mat overlay = roi.clone();
+			for (const auto pred : visible)
 			{
-				cv::Mat roi = annotated_image(pred.rect);
-				cv::Mat coloured_rect(roi.size(), roi.type(), colour);
-
-				const double alpha = config.annotation_shade_predictions;
-				const double beta = 1.0 - alpha;
-				cv::addWeighted(coloured_rect, alpha, roi, beta, 0.0, roi);
+				const auto colour = config.annotation_colours[pred->best_class % config.annotation_colours.size()];
+				cv::rectangle(overlay, (pred->rect & image_rect) - area.tl(), colour, CV_FILLED);
 			}
 
-//			std::cout << "class id=" << pred.best_class << ", probability=" << pred.best_probability << ", point=(" << pred.rect.x << "," << pred.rect.y << "), name=\"" << pred.name << "\", duration=" << duration_string() << std::endl;
-			cv::rectangle(annotated_image, pred.rect, colour, line_thickness_or_fill);
+			// pixels which are not covered by a prediction are identical in both images so they remain unchanged
+			const double alpha = config.annotation_shade_predictions;
+			const double beta = 1.0 - alpha;
+			cv::addWeighted(overlay, alpha, roi, beta, 0.0, roi);
+		}
+	}
 
-			if (config.annotation_suppress_all_labels)
-			{
-				continue;
-			}
+	const int line_thickness_or_fill = (config.annotation_shade_predictions >= 1.0 ? CV_FILLED : config.annotation_line_thickness);
+	for (const auto pred : visible)
+	{
+		const auto colour = config.annotation_colours[pred->best_class % config.annotation_colours.size()];
+		cv::rectangle(output, pred->rect, colour, line_thickness_or_fill);
+	}
 
-			int baseline = 0;
-			const cv::Size text_size = cv::getTextSize(pred.name, config.annotation_font_face, config.annotation_font_scale, config.annotation_font_thickness, &baseline);
+	if (not config.annotation_suppress_all_labels)
+	{
+		for (const auto pred : visible)
+		{
+			const auto colour = config.annotation_colours[pred->best_class % config.annotation_colours.size()];
+			const Label & label = get_label(pred->name, colour, output.type());
 
 			if (config.annotation_auto_hide_labels)
 			{
-				if (text_size.width >= pred.rect.width or
-					text_size.height >= pred.rect.height)
+				if (label.text_size.width >= pred->rect.width or
+					label.text_size.height >= pred->rect.height)
 				{
 					// label is too large to display
 					continue;
 				}
 			}
 
-			cv::Rect r(cv::Point(pred.rect.x - config.annotation_line_thickness/2, pred.rect.y - text_size.height - baseline + config.annotation_line_thickness), cv::Size(text_size.width + config.annotation_line_thickness, text_size.height + baseline));
-			if (r.x < 0) r.x = 0;																			// shift the label to the very left edge of the screen, otherwise it would be off-screen
-			if (r.x + r.width >= annotated_image.cols) r.x = pred.rect.x + pred.rect.width - r.width + 1;	// first attempt at pushing the label to the left
-			if (r.x + r.width >= annotated_image.cols) r.x = annotated_image.cols - r.width;				// more drastic attempt at pushing the label to the left
+			// if the label doesn't fit above the prediction, then move it left, below, or inside the prediction
+			cv::Rect r(cv::Point(pred->rect.x - config.annotation_line_thickness/2, pred->rect.y - label.bitmap.rows + config.annotation_line_thickness), label.bitmap.size());
+			if (r.x < 0) r.x = 0;
+			if (r.x + r.width >= output.cols) r.x = pred->rect.x + pred->rect.width - r.width + 1;
+			if (r.x + r.width >= output.cols) r.x = output.cols - r.width;
 
-			if (r.y < 0) r.y = pred.rect.y + pred.rect.height;	// shift the label to the bottom of the prediction, otherwise it would be off-screen
-			if (r.y + r.height >= annotated_image.rows) r.y = pred.rect.y + 1; // shift the label to the inside-top of the prediction (CV seems to have trouble drawing text where the upper bound is y=0, so move it down 1 pixel)
-			if (r.y < 0) r.y = 0; // shift the label to the top of the image if it is off-screen
+			if (r.y < 0) r.y = pred->rect.y + pred->rect.height;
+			if (r.y + r.height >= output.rows) r.y = pred->rect.y + 1;
+			if (r.y < 0) r.y = 0;
 
-			cv::rectangle(annotated_image, r, colour, CV_FILLED);
-			cv::putText(annotated_image, pred.name, cv::Point(r.x + config.annotation_line_thickness/2, r.y + text_size.height), config.annotation_font_face, config.annotation_font_scale, cv::Scalar(0,0,0), config.annotation_font_thickness, CV_AA);
+			// only copy the part of the label which is within the image
+			const cv::Rect visible_part = r & image_rect;
+			if (not visible_part.empty())
+			{
+				label.bitmap(visible_part - r.tl()).copyTo(output(visible_part));
+			}
 		}
 	}
 
+	render_duration_and_timestamp(output);
+
+	return;
+}
+
+
+const DarkHelp::NN::Label & DarkHelp::NN::get_label(const std::string & text, const cv::Scalar & colour, const int type)
+{
+	const std::string settings =
+		std::to_string(config.annotation_font_face		) + " " +
+		std::to_string(config.annotation_font_scale		) + " " +
+		std::to_string(config.annotation_font_thickness	) + " " +
+		std::to_string(config.annotation_line_thickness	);
+
+	// the percentages are part of the label text, so even with many classes the cache should remain relatively small
+	if (settings != label_cache_settings or label_cache.size() > 5000)
+	{
+		label_cache.clear();
+		label_cache_settings = settings;
+	}
+
+	const std::string key =
+		text + "\n" +
+		std::to_string(colour[0]) + " " +
+		std::to_string(colour[1]) + " " +
+		std::to_string(colour[2]) + " " +
+		std::to_string(type);
+
+	auto iter = label_cache.find(key);
+	if (iter == label_cache.end())
+	{
+		Label label;
+
+		int baseline = 0;
+		label.text_size = cv::getTextSize(text, config.annotation_font_face, config.annotation_font_scale, config.annotation_font_thickness, &baseline);
+
+		// the coloured rectangle behind the text, with the text positioned relative to the label instead of the image
+		label.bitmap = cv::Mat(label.text_size.height + baseline, label.text_size.width + config.annotation_line_thickness, type, colour);
+		cv::putText(label.bitmap, text, cv::Point(config.annotation_line_thickness/2, label.text_size.height), config.annotation_font_face, config.annotation_font_scale, cv::Scalar(0,0,0), config.annotation_font_thickness, CV_AA);
+
+		iter = label_cache.emplace(key, label).first;
+	}
+
+	return iter->second;
+}
+
+
+void DarkHelp::NN::render_duration_and_timestamp(cv::Mat & output)
+{
 	if (config.annotation_include_duration)
 	{
 		const std::string str		= duration_string();
 		const cv::Size text_size	= cv::getTextSize(str, config.annotation_font_face, config.annotation_font_scale, config.annotation_font_thickness, nullptr);
 
 		cv::Rect r(cv::Point(2, 2), cv::Size(text_size.width + 2, text_size.height + 2));
-		cv::rectangle(annotated_image, r, cv::Scalar(255,255,255), CV_FILLED);
-		cv::putText(annotated_image, str, cv::Point(r.x + 1, r.y + text_size.height), config.annotation_font_face, config.annotation_font_scale, cv::Scalar(0,0,0), config.annotation_font_thickness, CV_AA);
+		cv::rectangle(output, r, cv::Scalar(255,255,255), CV_FILLED);
+		cv::putText(output, str, cv::Point(r.x + 1, r.y + text_size.height), config.annotation_font_face, config.annotation_font_scale, cv::Scalar(0,0,0), config.annotation_font_thickness, CV_AA);
 	}
 
 	if (config.annotation_include_timestamp)
@@ -853,12 +1384,12 @@ cv::Mat DarkHelp::NN::annotate(const float new_threshold)
 
 		const cv::Size text_size = cv::getTextSize(timestamp, config.annotation_font_face, config.annotation_font_scale, config.annotation_font_thickness, nullptr);
 
-		cv::Rect r(cv::Point(2, annotated_image.rows - text_size.height - 4), cv::Size(text_size.width + 2, text_size.height + 2));
-		cv::rectangle(annotated_image, r, cv::Scalar(255,255,255), CV_FILLED);
-		cv::putText(annotated_image, timestamp, cv::Point(r.x + 1, r.y + text_size.height), config.annotation_font_face, config.annotation_font_scale, cv::Scalar(0,0,0), config.annotation_font_thickness, CV_AA);
+		cv::Rect r(cv::Point(2, output.rows - text_size.height - 4), cv::Size(text_size.width + 2, text_size.height + 2));
+		cv::rectangle(output, r, cv::Scalar(255,255,255), CV_FILLED);
+		cv::putText(output, timestamp, cv::Point(r.x + 1, r.y + text_size.height), config.annotation_font_face, config.annotation_font_scale, cv::Scalar(0,0,0), config.annotation_font_thickness, CV_AA);
 	}
 
-	return annotated_image;
+	return;
 }
 
 
@@ -1060,20 +1591,12 @@ void DarkHelp::NN::predict_internal_darknet()
 {
 	Darknet::NetworkPtr nw = reinterpret_cast<Darknet::NetworkPtr>(darknet_net);
 
-	cv::Mat resized_image;
-	if (config.use_fast_image_resize)
-	{
-		resized_image = fast_resize_ignore_aspect_ratio(original_image, network_dimensions);
-	}
-	else
-	{
-		resized_image = slow_resize_ignore_aspect_ratio(original_image, network_dimensions);
-	}
+	const cv::Mat & input = prepare_network_input();
 
 	tile_size = network_dimensions;
-	DarknetImage img = convert_opencv_mat_to_darknet_image(resized_image);
 
-	network_predict_ptr(nw, img.data);
+	// Darknet doesn't modify the input, but the API doesn't take a const pointer
+	network_predict_ptr(nw, const_cast<float *>(input.ptr<float>()));
 
 	int nboxes = 0;
 	const int use_letterbox = 0;
@@ -1128,6 +1651,8 @@ void DarkHelp::NN::predict_internal_darknet()
 		{
 			// at least 1 class is beyond the threshold, so remember this object
 
+			unletterbox(det.bbox.x, det.bbox.y, det.bbox.w, det.bbox.h);
+
 			if (config.fix_out_of_bound_values)
 			{
 				fix_out_of_bound_normalized_rect(det.bbox.x, det.bbox.y, det.bbox.w, det.bbox.h);
@@ -1150,7 +1675,6 @@ void DarkHelp::NN::predict_internal_darknet()
 	}
 
 	free_detections(darknet_results, nboxes);
-	free_image(img);
 
 	return;
 }
@@ -1164,24 +1688,12 @@ void DarkHelp::NN::predict_internal_opencv()
 
 	const size_t number_of_classes = names.size();
 
-	cv::Mat resized_image;
-	if (config.use_fast_image_resize)
-	{
-		resized_image = fast_resize_ignore_aspect_ratio(original_image, network_dimensions);
-	}
-	else
-	{
-		resized_image = slow_resize_ignore_aspect_ratio(original_image, network_dimensions);
-	}
+	// the blob is already RGB and normalized, same as what cv::dnn::blobFromImage() would have created with swapRB=true
+	const cv::Mat & input = prepare_network_input();
 
 	tile_size = network_dimensions;
 
-	/* OpenCV images are BGR, but DNN (or maybe specific to Darknet?) requires RGB,
-	 * so make sure to set the "swap" option, otherwise detection won't behave as
-	 * well as expected.
-	 */
-	auto blob = cv::dnn::blobFromImage(resized_image, 1.0 / 255.0, network_dimensions, {}, /* swapRB=*/true, /* crop=*/false);
-	opencv_net.setInput(blob);
+	opencv_net.setInput(input);
 
 	/* Get the names of all the layers we're interested in (should start with "yolo_").
 	 * This is important!  We're going to have to combine the results from all these layers.
@@ -1212,6 +1724,13 @@ void DarkHelp::NN::predict_internal_opencv()
 	std::vector<std::vector<cv::Mat>> output_mats;
 	opencv_net.forward(output_mats, yolo_layer_names);
 
+	// remember the output in case heatmaps are needed
+	opencv_yolo_outputs.clear();
+	for (const auto & mats : output_mats)
+	{
+		opencv_yolo_outputs.push_back(mats[0]);
+	}
+
 	/* To get the final output to behave/look as similar as we can to the original
 	 * darknet results, we'll need to refer back to the OpenCV results as we build
 	 * up the results vector.  For this reason, we need to know where in the matrix
@@ -1364,10 +1883,13 @@ void DarkHelp::NN::predict_internal_opencv()
 
 		if (pr.best_probability > 0.0f)
 		{
-			float & cx	= ptr[0];
-			float & cy	= ptr[1];
-			float & w	= ptr[2];
-			float & h	= ptr[3];
+			// copy the coordinates since the same row may be returned by NMS for more than 1 class
+			float cx	= ptr[0];
+			float cy	= ptr[1];
+			float w		= ptr[2];
+			float h		= ptr[3];
+
+			unletterbox(cx, cy, w, h);
 
 			if (config.fix_out_of_bound_values)
 			{
@@ -1395,6 +1917,86 @@ void DarkHelp::NN::predict_internal_opencv()
 }
 
 
+const cv::Mat & DarkHelp::NN::prepare_network_input()
+{
+	letterbox_rect = cv::Rect();
+
+	if (not external_network_input.empty())
+	{
+		// the caller has already prepared the input, see predict_tensor()
+		return external_network_input;
+	}
+
+	cv::Rect roi(cv::Point(0, 0), network_dimensions);
+
+	if (config.use_letterbox and original_image.size() != network_dimensions)
+	{
+		// scale the image the same way as resize_keeping_aspect_ratio(), and center it within the network dimensions
+		const double factor = std::min(
+			static_cast<double>(network_dimensions.width)	/ static_cast<double>(original_image.cols),
+			static_cast<double>(network_dimensions.height)	/ static_cast<double>(original_image.rows));
+
+		roi.width		= std::clamp(static_cast<int>(std::round(original_image.cols * factor)), 1, network_dimensions.width);
+		roi.height		= std::clamp(static_cast<int>(std::round(original_image.rows * factor)), 1, network_dimensions.height);
+		roi.x			= (network_dimensions.width		- roi.width	) / 2;
+		roi.y			= (network_dimensions.height	- roi.height) / 2;
+		letterbox_rect	= roi;
+	}
+
+	cv::Mat image = original_image;
+	if (image.channels() == 4)
+	{
+		cv::Mat bgr;
+		cv::cvtColor(image, bgr, cv::COLOR_BGRA2BGR);
+		image = bgr;
+	}
+
+	if (image.size() != roi.size())
+	{
+		// fill_network_input() does the same as the CPU version of fast_resize_ignore_aspect_ratio() while converting
+		// the image, so the image only needs to be resized beforehand for the GPU or when a better resize is requested
+		#ifdef HAVE_OPENCV_CUDAWARPING
+		if (config.use_fast_image_resize)
+		{
+			image = fast_resize_ignore_aspect_ratio(image, roi.size());
+		}
+		#endif
+
+		if (config.use_fast_image_resize == false)
+		{
+			image = slow_resize_ignore_aspect_ratio(image, roi.size());
+		}
+	}
+
+	// this only allocates the blob the first time, or if the network dimensions have changed
+	const int sizes[] = {1, number_of_channels, network_dimensions.height, network_dimensions.width};
+	network_input.create(4, sizes, CV_32F);
+
+	fill_network_input(image, network_input.ptr<float>(), network_dimensions, number_of_channels, roi);
+
+	return network_input;
+}
+
+
+void DarkHelp::NN::unletterbox(float & cx, float & cy, float & w, float & h) const
+{
+	if (letterbox_rect.empty())
+	{
+		return;
+	}
+
+	const float network_width	= network_dimensions.width;
+	const float network_height	= network_dimensions.height;
+
+	cx	= (cx * network_width	- letterbox_rect.x) / letterbox_rect.width;
+	cy	= (cy * network_height	- letterbox_rect.y) / letterbox_rect.height;
+	w	= w * network_width		/ letterbox_rect.width;
+	h	= h * network_height	/ letterbox_rect.height;
+
+	return;
+}
+
+
 DarkHelp::NN & DarkHelp::NN::name_prediction(PredictionResult & pred)
 {
 	pred.best_class = 0;
@@ -1443,11 +2045,26 @@ DarkHelp::NN & DarkHelp::NN::name_prediction(PredictionResult & pred)
 
 DarkHelp::NN & DarkHelp::NN::snap_annotations()
 {
-	for (auto & pred : prediction_results)
+	if (prediction_results.empty() or
+		(config.snapping_limit_shrink	>= 1.0f and	// cannot shrink
+		config.snapping_limit_grow		<= 1.0f))	// cannot grow
 	{
-		snap_annotation(pred);
+		return *this;
 	}
 
+	// create the binary image (or only allocate it when lazy binarization is enabled) before the threads are started
+	binarize(cv::Rect());
+
+	// each annotation is independent of the others, so they can all be snapped at the same time
+	cv::parallel_for_(cv::Range(0, static_cast<int>(prediction_results.size())),
+		[&](const cv::Range & range)
+		{
+			for (int idx = range.start; idx < range.end; idx ++)
+			{
+				snap_annotation(prediction_results[idx]);
+			}
+		});
+
 	return *this;
 }
 
@@ -1461,14 +2078,7 @@ DarkHelp::NN & DarkHelp::NN::snap_annotation(DarkHelp::PredictionResult & pred)
 		return *this;
 	}
 
-	if (binary_inverted_image.empty())
-	{
-		cv::Mat greyscale;
-		cv::Mat threshold;
-		cv::cvtColor(original_image, greyscale, cv::COLOR_BGR2GRAY);
-		cv::adaptiveThreshold(greyscale, threshold, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY, config.binary_threshold_block_size, config.binary_threshold_constant);
-		binary_inverted_image = ~ threshold;
-	}
+	binarize(pred.rect);
 
 	const auto original_rect	= pred.rect;
 	const float original_area	= original_rect.area();
@@ -1494,6 +2104,9 @@ DarkHelp::NN & DarkHelp::NN::snap_annotation(DarkHelp::PredictionResult & pred)
 		}
 	}
 
+	const cv::Rect image_rect(0, 0, binary_inverted_image.cols, binary_inverted_image.rows);
+	NonZeroFinder finder;
+
 	int attempt = 0;
 	while (true)
 	{
@@ -1531,13 +2144,18 @@ DarkHelp::NN & DarkHelp::NN::snap_annotation(DarkHelp::PredictionResult & pred)
 			roi.height = binary_inverted_image.rows - roi.y;
 		}
 
-		cv::Mat nonzero;
-		cv::findNonZero(binary_inverted_image(roi), nonzero);
-		auto new_rect = cv::boundingRect(nonzero);
+		if ((roi & finder.window) != roi)
+		{
+			// the RoI has grown beyond the window, so start again with a larger window (or this is the first attempt)
+			const int hpad = roi.width	/ 2 + config.snapping_horizontal_tolerance;
+			const int vpad = roi.height	/ 2 + config.snapping_vertical_tolerance;
+			const cv::Rect window = cv::Rect(roi.x - hpad, roi.y - vpad, roi.width + 2 * hpad, roi.height + 2 * vpad) & image_rect;
+
+			binarize(window);
+			finder.reset(binary_inverted_image, window);
+		}
 
-		// note that new_rect is relative to the RoI, so we need to move it back into the full image coordinate space
-		new_rect.x += roi.x;
-		new_rect.y += roi.y;
+		const auto new_rect = finder.bounding_rect(roi);
 
 		if (new_rect == final_rect)
 		{
@@ -1608,6 +2226,94 @@ DarkHelp::NN & DarkHelp::NN::snap_annotation(DarkHelp::PredictionResult & pred)
 }
 
 
+void DarkHelp::NN::binarize(const cv::Rect & roi)
+{
+	const int tile_size = 256;
+
+	/* When called from multiple threads, it is safe for the other threads to read from binary_inverted_image while we
+	 * are binarizing new tiles, since each thread only reads the tiles it has already binarized (or waited for) and
+	 * tiles are never modified once they have been binarized.
+	 */
+	std::scoped_lock lock(binarize_lock);
+
+	if (binary_inverted_image.empty())
+	{
+		if (not config.snapping_lazy_binarization)
+		{
+			cv::Mat greyscale;
+			cv::Mat threshold;
+			cv::cvtColor(original_image, greyscale, cv::COLOR_BGR2GRAY);
+			cv::adaptiveThreshold(greyscale, threshold, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY, config.binary_threshold_block_size, config.binary_threshold_constant);
+			binary_inverted_image = ~ threshold;
+			binarized_tiles = cv::Mat();
+
+			return;
+		}
+
+		binary_inverted_image	= cv::Mat::zeros(original_image.size(), CV_8UC1);
+		binarized_tiles			= cv::Mat::zeros((original_image.rows + tile_size - 1) / tile_size, (original_image.cols + tile_size - 1) / tile_size, CV_8UC1);
+	}
+
+	if (binarized_tiles.empty())
+	{
+		// the entire image has already been binarized
+		return;
+	}
+
+	const cv::Rect image_rect(0, 0, binary_inverted_image.cols, binary_inverted_image.rows);
+	const cv::Rect r = roi & image_rect;
+	if (r.empty())
+	{
+		return;
+	}
+
+	/* The adaptive threshold of each pixel only depends on the pixels within half a block of it, so as long as each region
+	 * is padded by that amount, the result is identical to binarizing the entire image.  (At the edges of the image the
+	 * padding is clipped, which is also what happens when the entire image is binarized.)
+	 */
+	const int padding = config.binary_threshold_block_size / 2 + 1;
+
+	const int first_row	= r.y / tile_size;
+	const int last_row	= (r.y + r.height - 1) / tile_size;
+	const int first_col	= r.x / tile_size;
+	const int last_col	= (r.x + r.width - 1) / tile_size;
+
+	for (int row = first_row; row <= last_row; row ++)
+	{
+		int col = first_col;
+		while (col <= last_col)
+		{
+			if (binarized_tiles.at<uint8_t>(row, col))
+			{
+				col ++;
+				continue;
+			}
+
+			// combine consecutive tiles on this row so they are binarized together
+			const int start_col = col;
+			while (col <= last_col and binarized_tiles.at<uint8_t>(row, col) == 0)
+			{
+				binarized_tiles.at<uint8_t>(row, col) = 1;
+				col ++;
+			}
+
+			const cv::Rect tiles = cv::Rect(start_col * tile_size, row * tile_size, (col - start_col) * tile_size, tile_size) & image_rect;
+			const cv::Rect padded = cv::Rect(tiles.x - padding, tiles.y - padding, tiles.width + 2 * padding, tiles.height + 2 * padding) & image_rect;
+
+			cv::Mat greyscale;
+			cv::Mat threshold;
+			cv::cvtColor(original_image(padded), greyscale, cv::COLOR_BGR2GRAY);
+			cv::adaptiveThreshold(greyscale, threshold, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY, config.binary_threshold_block_size, config.binary_threshold_constant);
+
+			cv::Mat dst = binary_inverted_image(tiles);
+			cv::bitwise_not(threshold(cv::Rect(tiles.x - padded.x, tiles.y - padded.y, tiles.width, tiles.height)), dst);
+		}
+	}
+
+	return;
+}
+
+
 cv::Mat DarkHelp::NN::heatmap_combined(const float threshold)
 {
 	cv::Mat mat;
@@ -1638,3 +2344,131 @@ DarkHelp::MMats DarkHelp::NN::heatmaps_all(const float threshold)
 
 	return mm;
 }
+
+
+DarkHelp::MMats DarkHelp::NN::heatmaps(const std::set<int> & classes, const float threshold, const cv::Rect & roi, const bool upsample)
+{
+	MMats mm;
+
+	if (original_image.empty() or network_dimensions.area() <= 0)
+	{
+		// nothing has been given to the neural network
+		return mm;
+	}
+
+	const cv::Rect image_rect(cv::Point(0, 0), original_image.size());
+	const cv::Rect image_roi = (roi.empty() ? image_rect : roi & image_rect);
+	if (image_roi.empty())
+	{
+		return mm;
+	}
+
+	// convert the region from image coordinates to network coordinates, taking letterboxing into account
+	const cv::Rect placement = (letterbox_rect.empty() ? cv::Rect(cv::Point(0, 0), network_dimensions) : letterbox_rect);
+	const double horizontal_factor	= static_cast<double>(placement.width)	/ original_image.cols;
+	const double vertical_factor	= static_cast<double>(placement.height)	/ original_image.rows;
+	const int x1 = placement.x + static_cast<int>(std::floor(image_roi.x							* horizontal_factor));
+	const int y1 = placement.y + static_cast<int>(std::floor(image_roi.y							* vertical_factor	));
+	const int x2 = placement.x + static_cast<int>(std::ceil((image_roi.x + image_roi.width)		* horizontal_factor));
+	const int y2 = placement.y + static_cast<int>(std::ceil((image_roi.y + image_roi.height)		* vertical_factor	));
+	const cv::Rect network_roi = cv::Rect(x1, y1, std::max(1, x2 - x1), std::max(1, y2 - y1)) & cv::Rect(cv::Point(0, 0), network_dimensions);
+	if (network_roi.empty())
+	{
+		return mm;
+	}
+
+	// only allocate the heatmaps which have been requested
+	cv::Mat & combined = mm[-1];
+	combined = cv::Mat(network_roi.size(), CV_32FC1, cv::Scalar(0));
+	for (const int class_idx : classes)
+	{
+		mm[class_idx] = cv::Mat(network_roi.size(), CV_32FC1, cv::Scalar(0));
+	}
+
+	// called for every object detected by the network, with coordinates normalized to the network dimensions
+	const auto add = [&](const float cx, const float cy, const float w, const float h, const int class_idx, const float probability)
+	{
+		if (probability < threshold)
+		{
+			return;
+		}
+
+		auto iter = mm.find(class_idx);
+		if (iter == mm.end())
+		{
+			if (not classes.empty())
+			{
+				// this class was not requested
+				return;
+			}
+			iter = mm.emplace(class_idx, cv::Mat(network_roi.size(), CV_32FC1, cv::Scalar(0))).first;
+		}
+
+		const cv::Rect r = cv::Rect(
+			static_cast<int>(std::round((cx - w / 2.0f) * network_dimensions.width	)),
+			static_cast<int>(std::round((cy - h / 2.0f) * network_dimensions.height	)),
+			static_cast<int>(std::round(w * network_dimensions.width				)),
+			static_cast<int>(std::round(h * network_dimensions.height				))) & network_roi;
+
+		if (not r.empty())
+		{
+			const cv::Rect relative = r - network_roi.tl();
+			iter->second(relative)	+= cv::Scalar(probability);
+			combined(relative)		+= cv::Scalar(probability);
+		}
+	};
+
+	if (config.driver == EDriver::kDarknet and darknet_net)
+	{
+		Darknet::NetworkPtr nw = reinterpret_cast<Darknet::NetworkPtr>(darknet_net);
+
+		// these are the same detections used by predict_internal_darknet(), but before non-maximal suppression
+		int nboxes = 0;
+		const int use_letterbox = 0;
+		auto darknet_results = get_network_boxes(nw, network_dimensions.width, network_dimensions.height, threshold, config.hierarchy_threshold, 0, 1, &nboxes, use_letterbox);
+
+		for (int detection_idx = 0; detection_idx < nboxes; detection_idx ++)
+		{
+			const auto & det = darknet_results[detection_idx];
+			for (int class_idx = 0; class_idx < det.classes; class_idx ++)
+			{
+				add(det.bbox.x, det.bbox.y, det.bbox.w, det.bbox.h, class_idx, det.prob[class_idx]);
+			}
+		}
+
+		free_detections(darknet_results, nboxes);
+	}
+	else
+	{
+		// see predict_internal_opencv() for the layout of these rows
+		const int number_of_classes = static_cast<int>(names.size());
+		for (const auto & output : opencv_yolo_outputs)
+		{
+			for (int row = 0; row < output.rows; row ++)
+			{
+				const float * const ptr = output.ptr<float>(row);
+				if (ptr[4] < threshold or output.cols < 5 + number_of_classes)
+				{
+					continue;
+				}
+
+				for (int class_idx = 0; class_idx < number_of_classes; class_idx ++)
+				{
+					add(ptr[0], ptr[1], ptr[2], ptr[3], class_idx, ptr[5 + class_idx]);
+				}
+			}
+		}
+	}
+
+	if (upsample)
+	{
+		for (auto & [class_idx, mat] : mm)
+		{
+			cv::Mat resized;
+			cv::resize(mat, resized, image_roi.size(), 0.0, 0.0, cv::INTER_LINEAR);
+			mat = resized;
+		}
+	}
+
+	return mm;
+}
@@ -141,6 +141,11 @@ namespace DarkHelp
 			/** Initialize ("load") the darknet neural network using a "bundle" @p .dh file created using the @p DarkHelpCombine
 			 * command-line tool.
 			 *
+			 * The bundle is memory-mapped and the neural network is loaded directly from memory, without extracting the
+			 * files to disk.  (When using the Darknet driver on platforms other than Linux, temporary files are still
+			 * needed since Darknet can only load from files.)  Both version 1 and version 2 bundles are supported.  See
+			 * @ref DarkHelp::Bundle.
+			 *
 			 * @param [in] delete_combined_bundle_once_loaded If this is set to @p true then the combined bundle filename will
 			 * be @em deleted from the drive once the neural network is loaded.  If you don't want the bundle file to be deleted
 			 * you must pass @p false for this parameter.
@@ -159,6 +164,30 @@ namespace DarkHelp
 			 */
 			NN & init(const bool delete_combined_bundle_once_loaded, const std::string & filename, const std::string & key = "", const EDriver driver = EDriver::kDarknet);
 
+			/** Initialize ("load") the neural network from memory instead of from files.  This can be used when the network
+			 * is embedded within the application, downloaded, or otherwise never written to disk.  Nothing is written to disk
+			 * and the buffers are not modified.  Changes such as @ref DarkHelp::Config::modify_batch_and_subdivisions are
+			 * applied to a copy of the @p .cfg in memory.
+			 *
+			 * @note Darknet can only load neural networks from files.  When using the Darknet driver on Linux, the @p .cfg
+			 * and @p .weights are copied to anonymous files which only exist in memory.  On other platforms, they are copied
+			 * to temporary files which are deleted once the network has been loaded.  The OpenCV drivers read directly from
+			 * the buffers.
+			 *
+			 * Since there are no files, @ref DarkHelp::Config::cfg_filename, @ref DarkHelp::Config::weights_filename, and
+			 * @ref DarkHelp::Config::names_filename are cleared.
+			 *
+			 * @param [in] cfg The content of the @p .cfg file.
+			 * @param [in] names_data The content of the @p .names file.  This may be empty.
+			 * @param [in] weights The content of the @p .weights file.
+			 * @param [in] driver Determines the backend driver to use.  See @ref EDriver for details.
+			 *
+			 * @see @ref DarkHelp::Bundle
+			 *
+			 * @since 2026-10-16
+			 */
+			NN & init_from_memory(const std::string_view cfg, const std::string_view names_data, const std::string_view weights, const EDriver driver = EDriver::kDarknet);
+
 			/** Initialize ("load") the darknet neural network.  This uses the values within @ref DarkHelp::NN::config
 			 * and is called automatically if the network files have been specified to the constructor.  You only need
 			 * to manually call @p init() if the default constructor without filenames is used.
@@ -298,6 +327,32 @@ namespace DarkHelp
 			 */
 			PredictionResults predict_tile(cv::Mat mat, const float new_threshold = -1.0f);
 
+			/** Use the neural network on a network input which has already been prepared by the caller, skipping all of the
+			 * image preprocessing.  This is meant for pipelines where the frames are converted elsewhere, such as by the
+			 * camera or on the GPU.  (Frames which are already the size of the network can also be passed to the usual
+			 * @ref DarkHelp::NN::predict(), in which case they are converted without being resized.)
+			 *
+			 * @param [in] tensor The network input, in the same layout that @p cv::dnn::blobFromImage() creates with a scale
+			 * factor of @p 1/255 and @p swapRB=true:  continuous @p CV_32F values between @p 0.0 and @p 1.0, with all the
+			 * red values first, then all the green values, then all the blue values.  Each plane must be exactly the size of
+			 * @ref network_size(), and there must be @ref image_channels() planes.  Any shape with the right number of values
+			 * is accepted, such as a @p 1xCxHxW blob.  The tensor is used as-is without being copied, and is no longer
+			 * referenced once this call returns.
+			 * @param [in] image The image used to create the tensor.  This becomes @ref DarkHelp::NN::original_image, which is
+			 * used to scale the prediction results to the image, as well as for annotations and snapping.  If empty, a black
+			 * image the size of the network is used instead.
+			 * @param [in] new_threshold Which threshold to use.  If less than zero, the previous threshold will be applied.
+			 * If >= 0, then @ref DarkHelp::Config::threshold will be set to this new value.
+			 *
+			 * @note Tiling and letterboxing are not applied.  The tensor must contain the entire image, stretched to the
+			 * network dimensions.
+			 *
+			 * @see @ref DarkHelp::fill_network_input()
+			 *
+			 * @since 2026-10-16
+			 */
+			PredictionResults predict_tensor(const cv::Mat & tensor, cv::Mat image = cv::Mat(), const float new_threshold = -1.0f);
+
 			/** Takes the most recent @ref DarkHelp::NN::prediction_results, and applies them to the most recent
 			 * @ref DarkHelp::NN::original_image.  The output annotated image is stored in @ref DarkHelp::NN::annotated_image
 			 * as well as returned to the caller.
@@ -334,6 +389,55 @@ namespace DarkHelp
 			 */
 			cv::Mat annotate(const float new_threshold = -1.0f);
 
+			/** Similar to @ref DarkHelp::NN::annotate(), but renders the annotations into the image provided by the
+			 * caller instead of cloning @ref DarkHelp::NN::original_image into @ref DarkHelp::NN::annotated_image.  This is
+			 * meant for video, where the same output buffer can be passed in for every frame:
+			 *
+			 * ~~~~
+			 * cv::Mat output;
+			 * while (cap.read(frame))
+			 * {
+			 *     nn.predict(frame);
+			 *     nn.annotate_into(output);   // output is only allocated on the first frame
+			 *     out.write(output);
+			 * }
+			 * ~~~~
+			 *
+			 * The content of @ref DarkHelp::NN::original_image is first copied into @p output, re-using the memory already
+			 * owned by @p output when it has the right size and type.  The annotations are then drawn by the same renderer
+			 * used by @ref annotate(), so both produce identical images.
+			 *
+			 * @returns A reference to @p output.
+			 *
+			 * @since 2026-10-16
+			 */
+			cv::Mat & annotate_into(cv::Mat & output, const float new_threshold = -1.0f);
+
+			/** Draw the annotations directly onto @p image without making any copies.  This is normally the frame which was
+			 * passed to @ref DarkHelp::NN::predict(), and which the caller no longer needs once it has been annotated:
+			 *
+			 * ~~~~
+			 * while (cap.read(frame))
+			 * {
+			 *     nn.predict(frame);
+			 *     nn.annotate_in_place(frame);
+			 *     out.write(frame);
+			 * }
+			 * ~~~~
+			 *
+			 * The annotations are rendered the same way as @ref DarkHelp::NN::annotate_into(), including pixelation which
+			 * is also done in-place.  @ref DarkHelp::NN::annotated_image is not modified.
+			 *
+			 * @note When @p image is the same frame which was given to @ref DarkHelp::NN::predict(), it shares the pixels
+			 * with @ref DarkHelp::NN::original_image, meaning the original image will also show the annotations.  Call
+			 * @ref annotate() or @ref annotate_into() instead if the original image needs to be preserved.
+			 *
+			 * @returns A reference to @p image.
+			 *
+			 * @since 2026-10-16
+			 */
+			cv::Mat & annotate_in_place(cv::Mat & image, const float new_threshold = -1.0f);
+
 			/** Return @ref DarkHelp::NN::duration as a text string which can then be added to the image during annotation.
 			 * For example, this might return @p "912 microseconds" or @p "375 milliseconds".
 			 * @see @ref DarkHelp::NN::annotate()
@@ -355,6 +459,9 @@ namespace DarkHelp
 			 * limits, and the amount of "snapping" required for each annotation since the process of "snapping"
 			 * is iterative and requires looking for blank spaces within the image.
 			 *
+			 * The annotations are independent of each other, so they are snapped in parallel using OpenCV's
+			 * @p cv::parallel_for_().  Use @p cv::setNumThreads() to control the number of threads.
+			 *
 			 * @see @ref DarkHelp::Config::snapping_enabled
 			 * @see @ref DarkHelp::Config::snapping_horizontal_tolerance
 			 *
@@ -382,7 +489,7 @@ namespace DarkHelp
 			 * threshold of @p 0.5f.
 			 *
 			 * @note This only applies when @ref DarkHelp::Config::driver is set to @ref EDriver::kDarknet.  The OpenCV DNN
-			 * module does not provide heatmaps.
+			 * module does not provide heatmaps.  See @ref heatmaps() which works with both drivers.
 			 *
 			 * @since 2024-11-27
 			 */
@@ -397,12 +504,35 @@ namespace DarkHelp
 			 * threshold of @p 0.5f.
 			 *
 			 * @note This only applies when @ref DarkHelp::Config::driver is set to @ref EDriver::kDarknet.  The OpenCV DNN
-			 * module does not provide heatmaps.
+			 * module does not provide heatmaps.  See @ref heatmaps() which works with both drivers.
 			 *
 			 * @since 2024-11-27
 			 */
 			MMats heatmaps_all(const float threshold = 0.1f);
 
+			/** Get the heatmaps for only some of the classes, and optionally only for part of the image.  Unlike
+			 * @ref heatmaps_all(), the heatmaps are only created for the requested classes, and only for the requested region.
+			 * The heatmaps are created from the output of the last call to the neural network, so this works with both the
+			 * Darknet and OpenCV drivers.
+			 *
+			 * Each pixel of a heatmap is the sum of the probabilities of the objects detected by the network at that pixel,
+			 * before non-maximal suppression.  Use @p cv::normalize() to scale a heatmap to @p 0.0-1.0.  The map is keyed by
+			 * the class ID, and the entry @p -1 combines all of the requested classes.
+			 *
+			 * @param [in] classes The class IDs for which heatmaps are needed.  If empty, all of the classes are included.
+			 * @param [in] threshold The minimum probability for an object to be included in the heatmaps.
+			 * @param [in] roi The region of @ref original_image for which heatmaps are needed.  If empty, the entire image is
+			 * used.
+			 * @param [in] upsample The heatmaps are normally returned at the resolution of the network, which is faster.  Set
+			 * this to @p true to resize the heatmaps to the resolution of @ref original_image.
+			 *
+			 * @note The heatmaps are for the image or tile which was last given to the neural network.  When using
+			 * @ref DarkHelp::NN::predict_tile() this is the last tile, not the entire image.
+			 *
+			 * @since 2026-10-16
+			 */
+			MMats heatmaps(const std::set<int> & classes, const float threshold = 0.1f, const cv::Rect & roi = cv::Rect(), const bool upsample = false);
+
 			/** The Darknet network pointer will only be set when the driver is @ref DarkHelp::EDriver::kDarknet
 			 * in @ref DarkHelp::NN::init().
 			 */
@@ -489,11 +619,105 @@ namespace DarkHelp
 			/// Called from @ref DarkHelp::NN::predict_internal().  @see @ref DarkHelp::NN::predict()
 			void predict_internal_opencv();
 
+			/** Fill in @ref network_input from @ref original_image.  This is called by both drivers.  The image is either
+			 * stretched to the network dimensions, or letterboxed when @ref DarkHelp::Config::use_letterbox is enabled.
+			 *
+			 * @returns Either @ref network_input, or @ref external_network_input when called from @ref predict_tensor().
+			 *
+			 * @see @ref DarkHelp::fill_network_input()
+			 */
+			const cv::Mat & prepare_network_input();
+
+			/** Convert the normalized coordinates returned by the neural network back to normalized coordinates within
+			 * @ref original_image.  This does nothing unless the image was letterboxed by @ref prepare_network_input().
+			 */
+			void unletterbox(float & cx, float & cy, float & w, float & h) const;
+
+			/** The normalized planar RGB input given to the neural network, as a @p 1xCxHxW @p CV_32F blob.  This is
+			 * re-used for every image, and is passed to Darknet as a pointer or to OpenCV as a blob.
+			 */
+			cv::Mat network_input;
+
+			/// Where the last image was placed within @ref network_input.  This is empty if it was not letterboxed.
+			cv::Rect letterbox_rect;
+
+			/// The tensor given to @ref predict_tensor().  This is only set while @ref predict_tensor() is running.
+			cv::Mat external_network_input;
+
+			/// The output of the YOLO layers from the last call to the OpenCV DNN driver.  Used by @ref heatmaps().
+			std::vector<cv::Mat> opencv_yolo_outputs;
+
+			/** Apply the changes to the @p .cfg which are requested by the configuration, such as
+			 * @ref DarkHelp::Config::modify_batch_and_subdivisions.  Only the copy in memory is modified.
+			 *
+			 * @returns The number of lines which were modified or inserted.
+			 *
+			 * @since 2026-10-16
+			 */
+			size_t apply_cfg_overrides(std::string & cfg);
+
+			/// Load the Darknet neural network.  Called from @ref init() and @ref init_from_memory().
+			void load_darknet_network(const std::string & cfg_filename, const std::string & weights_filename);
+
+			/// Set the OpenCV DNN backend and target based on @ref DarkHelp::Config::driver.
+			void select_opencv_backend();
+
+			/// Read the class names.  Called from @ref init() and @ref init_from_memory().
+			void load_names(std::istream & is, const std::string & source);
+
+			/// Read the network width, height, and channels from the @p .cfg.  Called from @ref init() and @ref init_from_memory().
+			void load_network_dimensions(std::istream & is, const std::string & source);
+
+			/// The last part of loading a neural network which is common to both @ref init() and @ref init_from_memory().
+			void finish_init(const std::chrono::high_resolution_clock::time_point & t1);
+
 			/** Give a consistent name to the given production result.  This gets called by both @ref DarkHelp::NN::predict_internal()
 			 * and @ref DarkHelp::NN::predict_tile() and is intended for internal use only.
 			 */
 			NN & name_prediction(PredictionResult & pred);
 
+			/** Make sure @ref binary_inverted_image is available for the given region of the image.  When
+			 * @ref DarkHelp::Config::snapping_lazy_binarization is enabled, only the tiles overlapping the region which have
+			 * not yet been binarized are processed, otherwise the entire image is binarized the first time this is called.
+			 */
+			void binarize(const cv::Rect & roi);
+
+			/** One entry per 256x256 tile of @ref binary_inverted_image, set to non-zero once that tile has been binarized.
+			 * This is empty when the entire image has been binarized at once.  @see @ref binarize()
+			 */
+			cv::Mat binarized_tiles;
+
+			/// Allows @ref binarize() to be called from multiple threads by @ref snap_annotations().
+			std::mutex binarize_lock;
+
+			/** Draw the predictions onto @p output, which must already contain a copy of @ref original_image.  This is the
+			 * renderer used by @ref annotate(), @ref annotate_into(), and @ref annotate_in_place().  The labels are rendered
+			 * once into bitmaps which are then cached and copied into the image for subsequent frames, and all the shaded
+			 * rectangles are blended with a single call to @p cv::addWeighted() before the rectangles and labels are drawn.
+			 */
+			void render_annotations(cv::Mat & output);
+
+			/// Draw the duration and timestamp onto the image if they are enabled in @ref DarkHelp::Config.
+			void render_duration_and_timestamp(cv::Mat & output);
+
+			/// A label which has already been rendered by @ref get_label().
+			struct Label
+			{
+				cv::Mat bitmap;			///< The filled label rectangle with the text drawn into it.
+				cv::Size text_size;		///< The size returned by @p cv::getTextSize(), used to hide labels which are too large.
+			};
+
+			/** Get the label for the given text and colour, rendering it first if it isn't already in @ref label_cache.
+			 * The cache is cleared whenever the font or line settings in @ref DarkHelp::Config have changed.
+			 */
+			const Label & get_label(const std::string & text, const cv::Scalar & colour, const int type);
+
+			/// Labels which were previously rendered by @ref get_label(), keyed by text, colour, and image type.
+			std::map<std::string, Label> label_cache;
+
+			/// The font and line settings used to render the labels currently in @ref label_cache.
+			std::string label_cache_settings;
+
 			/// Size of the neural network, e.g., @p 416x416 or @p 608x608.  @see @ref DarkHelp::NN::network_size()
 			cv::Size network_dimensions;
 
@@ -0,0 +1,113 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <semaphore.h>
+
+
+/** @file
+ * Layout of the POSIX shared memory object used to submit raw video frames to %DarkHelp Server.  This file is meant to be
+ * included by the applications which produce the frames, and is installed with the other %DarkHelp headers.  See
+ * @ref ServerSharedMemory.
+ */
+
+
+namespace DarkHelp
+{
+	namespace SharedMemory
+	{
+		/// Used to validate the shared memory object.  These are the characters @p "DHSM".
+		constexpr uint32_t kMagic	= 0x4d534844;
+		constexpr uint32_t kVersion	= 2;
+
+		/// Frames are always 8-bit 3-channel BGR, the same as a @p cv::Mat with type @p CV_8UC3.
+		constexpr uint32_t kFormatBGR = 0;
+
+		/** The header at the very start of the shared memory object.  This is created and initialized by %DarkHelp Server.
+		 * Producers must validate @p magic and @p version before using the offsets and sizes.  When %DarkHelp Server
+		 * exits, @p magic is reset to zero, so producers should check it again every time they wake up.
+		 */
+		struct alignas(64) Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t number_of_slots;
+			uint32_t frame_timeout_ms;		///< How long %DarkHelp Server waits for a reserved frame to be published.  @see @ref FrameSlot
+			uint64_t frame_slot_size;		///< Size of each frame slot, including the @ref FrameSlot header.
+			uint64_t frame_slots_offset;	///< Offset from the start of the shared memory object to the first frame slot.
+			uint64_t result_slot_size;		///< Size of each result slot, including the @ref ResultSlot header.
+			uint64_t result_slots_offset;	///< Offset from the start of the shared memory object to the first result slot.
+
+			/** Producers call @p next_sequence.fetch_add(1) to reserve a sequence number.  Sequence numbers start at @p 1,
+			 * and the frame with sequence number @p N is stored in slot @p N @p % @p number_of_slots.
+			 */
+			std::atomic<uint64_t> next_sequence;
+
+			/** Producers must call @p sem_post() on this once a frame has been published.  %DarkHelp Server never destroys
+			 * this semaphore, since producers may still be using it when the server exits.
+			 */
+			sem_t frames_available;
+		};
+
+		/** Each frame slot starts with this header, immediately followed by the pixel data.
+		 *
+		 * To publish a frame, a producer must:
+		 *
+		 * @li reserve a sequence number @p N from @ref Header::next_sequence
+		 * @li let @p P be the previous sequence number stored in this slot, which is @p max(0, @p N @p - @p number_of_slots)
+		 * @li wait until @p consumed is equal to @p P, meaning %DarkHelp Server is done with the previous frame in this slot
+		 * @li copy the frame to the pixel data and set @p width, @p height, @p stride, and @p format
+		 * @li publish the frame with @p sequence.compare_exchange_strong(P, N) and post @ref Header::frames_available
+		 *
+		 * Sequence numbers are always processed in order.  If a producer reserves a sequence number but does not publish
+		 * the frame within @ref Header::frame_timeout_ms of the slot becoming available -- for example because the
+		 * producer crashed -- then %DarkHelp Server skips that sequence number.  It does this by storing @p N in
+		 * @p sequence itself and publishing an error in the result slot.  A producer which is that late will see
+		 * @p consumed become @p N instead of @p P, or its compare-and-exchange will fail, and must not write to the slot.
+		 *
+		 * %DarkHelp Server runs inference directly on the shared memory without making a copy of the frame, which is why
+		 * the producer must not modify the slot until @p consumed has been updated.
+		 */
+		struct alignas(64) FrameSlot
+		{
+			std::atomic<uint64_t> sequence;
+			std::atomic<uint64_t> consumed;
+			uint32_t width;
+			uint32_t height;
+			uint32_t stride;				///< Number of bytes between the start of each row.
+			uint32_t format;				///< Must be @ref kFormatBGR.
+			uint64_t timestamp;				///< Not used by %DarkHelp Server.  Can be set to anything the producer wants.
+		};
+
+		/** Each result slot starts with this header, immediately followed by @p length bytes of JSON text.  The results for
+		 * the frame with sequence number @p N are stored in result slot @p N @p % @p number_of_slots.  %DarkHelp Server
+		 * sets @p sequence to @p 0 before it starts writing to the slot, and to @p N once the JSON text has been written.
+		 *
+		 * Results should be read before another @ref Header::number_of_slots frames have been submitted, after which the
+		 * result slot is re-used.  Since the slot may be re-used while a producer is still copying the results, this works
+		 * like a seqlock, and to read the results a producer must:
+		 *
+		 * @li wait until @p sequence is equal to @p N (acquire semantics)
+		 * @li copy @p length bytes of JSON text out of the slot
+		 * @li call @p std::atomic_thread_fence(std::memory_order_acquire) and check @p sequence again
+		 * @li if @p sequence is no longer @p N, the copy may be torn and must be discarded since the results are lost
+		 *
+		 * Producers wait for their results by checking @p sequence (acquire semantics).  Instead of polling, a producer
+		 * can read @p futex, check @p sequence, and if the results are not yet available call @p FUTEX_WAIT (without
+		 * @p FUTEX_PRIVATE_FLAG) on @p futex with the value it read.  %DarkHelp Server increments @p futex and calls
+		 * @p FUTEX_WAKE every time results are published to this slot, which is also when @ref FrameSlot::consumed is
+		 * updated for the frame slot with the same index, so the same futex can be used to wait for a frame slot.
+		 */
+		struct alignas(64) ResultSlot
+		{
+			std::atomic<uint64_t> sequence;
+			uint64_t length;
+			std::atomic<uint32_t> futex;
+		};
+	}
+}
@@ -48,102 +48,87 @@ DarkHelp::DHThreads & DarkHelp::DHThreads::init(const DarkHelp::Config & c, cons
 {
 	stop();
 
-	if (workers < 1 or workers > 32)
-	{
-		/* For safety reasons, an upper bound has been set on the number of workers threads to start.  If you have a really
-		 * beefy system with an incredible amount of vram and ram, it is possible you might want more than this, in which
-		 * case you'll have to edit the limit above.  But as of March 2024, it is unlikely you'd have more than 32 parallel
-		 * copies of DarkHelp running at once.
-		 */
-		throw std::invalid_argument("number of worker threads seems to be unusual: " + std::to_string(workers));
-	}
+	DarkHelp::Config config = c;
 
-	std::filesystem::create_directories(output_directory);
-	output_dir = std::filesystem::canonical(output_directory);
-
-	cfg = c;
-	worker_threads_to_start = workers;
-
-	// if the .cfg file needs to be modified, make sure you do this just once before all the threads are started,
-	// otherwise we may end up re-writing the .cfg file in the middle of another thread attempting to load the network
-	if (cfg.modify_batch_and_subdivisions)
+	// the .cfg file is no longer re-written on disk (see NN::init()) so the threads can all load the network at the same
+	// time, but we still want to make sure the filenames are correct before the files are read
+	if (config.modify_batch_and_subdivisions)
 	{
-		DarkHelp::verify_cfg_and_weights(cfg.cfg_filename, cfg.weights_filename, cfg.names_filename);
-		const MStr m =
-		{
-			{"batch"		, "1"},
-			{"subdivisions"	, "1"}
-		};
-		edit_cfg_file(cfg.cfg_filename, m);
+		DarkHelp::verify_cfg_and_weights(config.cfg_filename, config.weights_filename, config.names_filename);
 	}
 
-	// start all of the necessary threads
-	restart();
-
-	return *this;
+	// the files are read into the model cache by restart()
+	return start_workers(config, workers, output_directory);
 }
 
 
 DarkHelp::DHThreads & DarkHelp::DHThreads::init(const std::filesystem::path & filename, const std::string & key, const size_t workers, const std::filesystem::path & output_directory, const DarkHelp::EDriver & driver)
 {
-	std::filesystem::path cfg_filename;
-	std::filesystem::path names_filename;
-	std::filesystem::path weights_filename;
+	stop();
 
-	auto cleanup = [&]()
-	{
-		if (not cfg_filename	.empty()) std::filesystem::remove(cfg_filename);
-		if (not names_filename	.empty()) std::filesystem::remove(names_filename);
-		if (not weights_filename.empty()) std::filesystem::remove(weights_filename);
-	};
+	model = DarkHelp::ModelCache::load(filename, key);
 
-	try
+	DarkHelp::Config config;
+	config.driver = driver;
+
+	start_workers(config, workers, output_directory);
+
+	// wait until all the threads have finished loading the neural network so get_nn() can be called immediately
+	// ...but in case a worker thread throws an exception and we never reach the desired number, we
+	// also need to be ready to bail out after a certain amount of time so we don't "hang" everything
+	auto time_last_change_was_detected = std::chrono::high_resolution_clock::now();
+	size_t previous_number_of_networks_loaded = 0;
+	while (true)
 	{
-		DarkHelp::extract(key, filename, cfg_filename, names_filename, weights_filename);
-		DarkHelp::Config config(cfg_filename.string(), weights_filename.string(), names_filename.string(), false, driver);
+		const auto number_of_networks_loaded = networks_loaded();
+		const auto now = std::chrono::high_resolution_clock::now();
 
-		init(config, workers, output_directory);
+		if (number_of_networks_loaded >= workers)
+		{
+			break;
+		}
 
-		// wait until all the threads have finished loading the neural network before we delete the files
-		// ...but in case a worker thread throws an exception and we never reach the desired number, we
-		// also need to be ready to bail out after a certain amount of time so we don't "hang" everything
-		auto time_last_change_was_detected = std::chrono::high_resolution_clock::now();
-		size_t previous_number_of_networks_loaded = 0;
-		while (true)
+		if (number_of_networks_loaded != previous_number_of_networks_loaded)
 		{
-			const auto number_of_networks_loaded = networks_loaded();
-			const auto now = std::chrono::high_resolution_clock::now();
+			previous_number_of_networks_loaded = number_of_networks_loaded;
+			time_last_change_was_detected = now;
+		}
 
-			if (number_of_networks_loaded >= workers)
-			{
-				break;
-			}
+		if (now > time_last_change_was_detected + std::chrono::seconds(60))
+		{
+			// nothing has changed in 60 seconds...!?
+			std::cout << "timeout waiting for network to load (" << number_of_networks_loaded << "/" << workers << ")" << std::endl;
+			break;
+		}
 
-			if (number_of_networks_loaded != previous_number_of_networks_loaded)
-			{
-				previous_number_of_networks_loaded = number_of_networks_loaded;
-				time_last_change_was_detected = now;
-			}
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	}
 
-			if (now > time_last_change_was_detected + std::chrono::seconds(60))
-			{
-				// nothing has changed in 60 seconds...!?
-				std::cout << "timeout waiting for network to load (" << number_of_networks_loaded << "/" << workers << ")" << std::endl;
-				break;
-			}
+	return *this;
+}
 
-			std::this_thread::sleep_for(std::chrono::milliseconds(200));
-		}
 
-		cleanup();
-	}
-	catch (...)
+DarkHelp::DHThreads & DarkHelp::DHThreads::start_workers(const DarkHelp::Config & c, const size_t workers, const std::filesystem::path & output_directory)
+{
+	if (workers < 1 or workers > 32)
 	{
-		cleanup();
-
-		throw;
+		/* For safety reasons, an upper bound has been set on the number of workers threads to start.  If you have a really
+		 * beefy system with an incredible amount of vram and ram, it is possible you might want more than this, in which
+		 * case you'll have to edit the limit above.  But as of March 2024, it is unlikely you'd have more than 32 parallel
+		 * copies of DarkHelp running at once.
+		 */
+		throw std::invalid_argument("number of worker threads seems to be unusual: " + std::to_string(workers));
 	}
 
+	std::filesystem::create_directories(output_directory);
+	output_dir = std::filesystem::canonical(output_directory);
+
+	cfg = c;
+	worker_threads_to_start = workers;
+
+	// start all of the necessary threads
+	restart();
+
 	return *this;
 }
 
@@ -152,6 +137,13 @@ DarkHelp::DHThreads & DarkHelp::DHThreads::restart()
 {
 	stop();
 
+	if (not cfg.cfg_filename.empty())
+	{
+		// this is quick when the files have not changed since they'll already be in the cache, and it means changes to
+		// the filenames in "cfg" are respected (when a bundle is used, the filenames are empty and the model is kept)
+		model = DarkHelp::ModelCache::load(cfg.cfg_filename, cfg.weights_filename, cfg.names_filename);
+	}
+
 	input_image_index = 0;
 	stop_requested = false;
 	threads.reserve(worker_threads_to_start);
@@ -350,7 +342,17 @@ void DarkHelp::DHThreads::run(const size_t id)
 {
 	try
 	{
-		DarkHelp::NN nn(cfg);
+		// every thread loads the network from the same copy of the files in memory
+		DarkHelp::NN nn;
+		nn.config = cfg;
+		if (model)
+		{
+			nn.init_from_memory(model->cfg, model->names, model->weights, cfg.driver);
+		}
+		else
+		{
+			nn.init();
+		}
 		networks[id] = &nn;
 
 		threads_ready ++;
@@ -84,7 +84,8 @@ namespace DarkHelp
 			 * Run the CLI tool @p DarkHelpCombine to create a @p .dh bundle file.
 			 *
 			 * Unlike the other @p DHThreads constructor, this one will wait until all the worker threads have fully loaded the
-			 * neural network before returning to the caller.  (This is required due to the use of the obfuscated bundle file.)
+			 * neural network before returning to the caller.  The bundle is decoded once into the @ref DarkHelp::ModelCache,
+			 * and nothing is extracted to disk.
 			 *
 			 * @see @ref DarkHelp::combine()
 			 *
@@ -113,8 +114,10 @@ namespace DarkHelp
 			 * manually if @ref stop() was called.  Calling @p restart() when the threads are already running will cause the
 			 * existing threads to stop, input files to be cleared, and existing results to be reset.
 			 *
-			 * @warning If a "bundle" file was used when loading the neural network, then the @p .cfg, @p .names, and @p .weights
-			 * files do not exist on disk and the call to @p restart() will fail since the neural network cannot be loaded.
+			 * The files used to load the neural network are kept in memory by the @ref DarkHelp::ModelCache, so @p restart()
+			 * does not need to read them from disk again.  This also means @p restart() works when the neural network was
+			 * loaded from a "bundle" file, and that changes to @ref cfg such as the threshold can be applied by calling
+			 * @p restart().  (Prior to October 2026, @p restart() would fail when a bundle was used.)
 			 *
 			 * @see @ref init()
 			 *
@@ -255,6 +258,14 @@ namespace DarkHelp
 			/// The method that each worker thread runs to process images.  @see @ref restart()
 			void run(const size_t id);
 
+			/// Validate the parameters and start the worker threads once @ref model has been set.
+			DHThreads & start_workers(const DarkHelp::Config & c, const size_t workers, const std::filesystem::path & output_directory);
+
+			/** The files needed by the worker threads to load the neural network.  This is shared with the
+			 * @ref DarkHelp::ModelCache so the files are only read or decoded once.
+			 */
+			DarkHelp::ModelCache::SPModel model;
+
 			/// If the threads need to stop, set this variable to @p true.  @see @ref stop()
 			std::atomic<bool> stop_requested;
 
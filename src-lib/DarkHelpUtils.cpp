@@ -5,7 +5,11 @@
 
 #include "DarkHelp.hpp"
 
+#include <cstring>
+#include <numeric>
+#include <random>
 #include <regex>
+#include <sstream>
 #include <sys/stat.h>
 
 // dup(), dup2(), and open() needed to redirect STDOUT and STDERR
@@ -280,139 +284,154 @@ DarkHelp::MStr DarkHelp::verify_cfg_and_weights(std::string & cfg_filename, std:
 }
 
 
-size_t DarkHelp::edit_cfg_file(const std::string & cfg_filename, DarkHelp::MStr m)
+namespace
 {
-	if (m.empty())
-	{
-		// nothing to do!
-		return 0;
-	}
+	/** Read the configuration from the stream into @p v and modify the lines in the @p [net] section.
+	 * @see @ref DarkHelp::edit_cfg_file()
+	 * @see @ref DarkHelp::edit_cfg_text()
+	 */
+	size_t edit_cfg_lines(std::istream & is, DarkHelp::MStr m, const std::string & description, DarkHelp::VStr & v)
+	{
+		// read the file and look for the [net] section
+		bool net_section_found	= false;
+		size_t net_idx_start	= 0;
+		size_t net_idx_end		= 0;
+		std::string cfg_line;
+		while (std::getline(is, cfg_line))
+		{
+			// strip whitespace at the end of line so we don't have problems between \n on Linux and \r\n on Windows
+			const size_t pos = cfg_line.find_last_not_of(" \t\r\n");
+			if (pos != std::string::npos)
+			{
+				cfg_line.erase(pos + 1);
+			}
 
-	std::ifstream ifs(cfg_filename);
-	if (not ifs.is_open())
-	{
-		/// @throw std::invalid_argument if the cfg file does not exist or cannot be opened
-		throw std::invalid_argument("failed to open the configuration file " + cfg_filename);
-	}
+			if (cfg_line.size() >= 5 and cfg_line.substr(0, 5) == "[net]")
+			{
+				net_idx_start	= v.size();
+				net_idx_end		= v.size();
+				net_section_found = true;
+			}
+			else if (cfg_line.size() >= 3)
+			{
+				if (net_section_found == true)
+				{
+					if (net_idx_end == net_idx_start)
+					{
+						if (cfg_line[0] == '[')
+						{
+							// we found the start of a new section, so this must mean the end of [net] has been found
+							net_idx_end = v.size();
+						}
+					}
+				}
+			}
 
-	// read the file and look for the [net] section
-	bool net_section_found	= false;
-	size_t net_idx_start	= 0;
-	size_t net_idx_end		= 0;
-	VStr v;
-	std::string cfg_line;
-	while (std::getline(ifs, cfg_line))
-	{
-		// strip whitespace at the end of line so we don't have problems between \n on Linux and \r\n on Windows
-		const size_t pos = cfg_line.find_last_not_of(" \t\r\n");
-		if (pos != std::string::npos)
+			v.push_back(cfg_line);
+		}
+
+		if (net_idx_start == net_idx_end)
 		{
-			cfg_line.erase(pos + 1);
+			/// @throw std::runtime_error if a valid start and end to the [net] section wasn't found in the .cfg file
+			throw std::runtime_error("failed to properly identify the [net] section in " + description);
 		}
 
-		if (cfg_line.size() >= 5 and cfg_line.substr(0, 5) == "[net]")
+		// look at every line in the [net] section to see if it matches one of the keys we want to modify
+		const std::regex rx(
+			"^"				// start of text
+			"\\s*"			// consume all whitespace
+			"("				// group #1
+				"[^#=\\s]+"	// not "#", "=", or whitespace
+			")"
+			"\\s*"			// consume all whitespace
+			"="				// "="
+			"\\s*"			// consume all whitespace
+			"("				// group #2
+				".*"		// old value and any trailing text (e.g., comments)
+			")"
+			"$"				// end of text
+		);
+
+		bool initial_modification = false;
+		if (m.size()				== 2	and
+			m.count("batch")		== 1	and
+			m.count("subdivisions")	== 1	and
+			m["batch"]				== "1"	and
+			m["subdivisions"]		== "1"	)
 		{
-			net_idx_start	= v.size();
-			net_idx_end		= v.size();
-			net_section_found = true;
+			// we need to know if this is the initial batch/subdivisions modification performed by init()
+			// because there are cases were we'll need to abort modifying the .cfg file if this is the case
+			initial_modification = true;
 		}
-		else if (cfg_line.size() >= 3)
+
+		size_t number_of_changed_lines = 0;
+		for (size_t idx = net_idx_start; idx < net_idx_end; idx ++)
 		{
-			if (net_section_found == true)
+			std::string & line = v[idx];
+
+			std::smatch sm;
+			if (std::regex_match(line, sm, rx))
 			{
-				if (net_idx_end == net_idx_start)
+				const std::string key = sm[1].str();
+				const std::string val = sm[2].str();
+
+				if (key						== "contrastive"	and
+					val						== "1"				and
+					initial_modification	== true				)
+				{
+					// this is one of the new configuration files that uses "contrastive", so don't modify "batch" and "subdivisions" so we
+					// can avoid the darknet error about "mini_batch size (batch/subdivisions) should be higher than 1 for Contrastive loss"
+					return 0;
+				}
+
+				// now see if this key is one of the ones we want to modify
+				if (m.count(key) == 1)
 				{
-					if (cfg_line[0] == '[')
+					if (val != m.at(key))
 					{
-						// we found the start of a new section, so this must mean the end of [net] has been found
-						net_idx_end = v.size();
+						line = key + "=" + m.at(key);
+						number_of_changed_lines ++;
 					}
+					m.erase(key);
 				}
 			}
 		}
 
-		v.push_back(cfg_line);
-	}
-	ifs.close();
+		// whatever is left in the map at this point needs to be inserted at the end of the [net] section (must be a new key)
+		for (auto iter : m)
+		{
+			const std::string & key = iter.first;
+			const std::string & val = iter.second;
+			const std::string line = key + "=" + val;
 
-	if (net_idx_start == net_idx_end)
-	{
-		/// @throw std::runtime_error if a valid start and end to the [net] section wasn't found in the .cfg file
-		throw std::runtime_error("failed to properly identify the [net] section in " + cfg_filename);
+			v.insert(v.begin() + net_idx_end, line);
+			number_of_changed_lines ++;
+			net_idx_end ++;
+		}
+
+		return number_of_changed_lines;
 	}
+}
 
-	// look at every line in the [net] section to see if it matches one of the keys we want to modify
-	const std::regex rx(
-		"^"				// start of text
-		"\\s*"			// consume all whitespace
-		"("				// group #1
-			"[^#=\\s]+"	// not "#", "=", or whitespace
-		")"
-		"\\s*"			// consume all whitespace
-		"="				// "="
-		"\\s*"			// consume all whitespace
-		"("				// group #2
-			".*"		// old value and any trailing text (e.g., comments)
-		")"
-		"$"				// end of text
-	);
 
-	bool initial_modification = false;
-	if (m.size()				== 2	and
-		m.count("batch")		== 1	and
-		m.count("subdivisions")	== 1	and
-		m["batch"]				== "1"	and
-		m["subdivisions"]		== "1"	)
+size_t DarkHelp::edit_cfg_file(const std::string & cfg_filename, DarkHelp::MStr m)
+{
+	if (m.empty())
 	{
-		// we need to know if this is the initial batch/subdivisions modification performed by init()
-		// because there are cases were we'll need to abort modifying the .cfg file if this is the case
-		initial_modification = true;
+		// nothing to do!
+		return 0;
 	}
 
-	size_t number_of_changed_lines = 0;
-	for (size_t idx = net_idx_start; idx < net_idx_end; idx ++)
+	std::ifstream ifs(cfg_filename);
+	if (not ifs.is_open())
 	{
-		std::string & line = v[idx];
-
-		std::smatch sm;
-		if (std::regex_match(line, sm, rx))
-		{
-			const std::string key = sm[1].str();
-			const std::string val = sm[2].str();
-
-			if (key						== "contrastive"	and
-				val						== "1"				and
-				initial_modification	== true				)
-			{
-				// this is one of the new configuration files that uses "contrastive", so don't modify "batch" and "subdivisions" so we
-				// can avoid the darknet error about "mini_batch size (batch/subdivisions) should be higher than 1 for Contrastive loss"
-				return 0;
-			}
-
-			// now see if this key is one of the ones we want to modify
-			if (m.count(key) == 1)
-			{
-				if (val != m.at(key))
-				{
-					line = key + "=" + m.at(key);
-					number_of_changed_lines ++;
-				}
-				m.erase(key);
-			}
-		}
+		/// @throw std::invalid_argument if the cfg file does not exist or cannot be opened
+		throw std::invalid_argument("failed to open the configuration file " + cfg_filename);
 	}
 
-	// whatever is left in the map at this point needs to be inserted at the end of the [net] section (must be a new key)
-	for (auto iter : m)
-	{
-		const std::string & key = iter.first;
-		const std::string & val = iter.second;
-		const std::string line = key + "=" + val;
-
-		v.insert(v.begin() + net_idx_end, line);
-		number_of_changed_lines ++;
-		net_idx_end ++;
-	}
+	VStr v;
+	const size_t number_of_changed_lines = edit_cfg_lines(ifs, m, cfg_filename, v);
+	ifs.close();
 
 	if (number_of_changed_lines == 0)
 	{
@@ -445,6 +464,31 @@ size_t DarkHelp::edit_cfg_file(const std::string & cfg_filename, DarkHelp::MStr
 }
 
 
+size_t DarkHelp::edit_cfg_text(std::string & cfg, DarkHelp::MStr m)
+{
+	if (m.empty())
+	{
+		// nothing to do!
+		return 0;
+	}
+
+	VStr v;
+	std::istringstream iss(cfg);
+	const size_t number_of_changed_lines = edit_cfg_lines(iss, m, "the configuration", v);
+
+	if (number_of_changed_lines > 0)
+	{
+		cfg.clear();
+		for (const auto & line : v)
+		{
+			cfg += line + "\n";
+		}
+	}
+
+	return number_of_changed_lines;
+}
+
+
 void DarkHelp::fix_out_of_bound_normalized_rect(float & cx, float & cy, float & w, float & h)
 {
 	// coordinates are all normalized!
@@ -575,6 +619,158 @@ cv::Mat DarkHelp::slow_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv:
 }
 
 
+void DarkHelp::fill_network_input(const cv::Mat & src, float * dst, const cv::Size & network_size, const int channels, const cv::Rect & roi)
+{
+	if (src.empty() or dst == nullptr)
+	{
+		/// @throw std::invalid_argument if the image or the output is empty.
+		throw std::invalid_argument("cannot prepare the network input from an empty image");
+	}
+
+	if (src.type() != CV_8UC3 and src.type() != CV_8UC1)
+	{
+		/// @throw std::invalid_argument if the image is not 8-bit BGR or greyscale.
+		throw std::invalid_argument("the network input must be prepared from an 8-bit BGR or greyscale image");
+	}
+
+	if (channels != 3 and channels != 1)
+	{
+		/// @throw std::invalid_argument if the number of channels is not 1 or 3.
+		throw std::invalid_argument("the network input must have either 1 or 3 channels");
+	}
+
+	if (roi.empty() or (roi & cv::Rect(cv::Point(0, 0), network_size)) != roi)
+	{
+		/// @throw std::invalid_argument if the region is not within the network dimensions.
+		throw std::invalid_argument("invalid region for the network input");
+	}
+
+	const int		src_channels	= src.channels();
+	const int		width			= network_size.width;
+	const int		height			= network_size.height;
+	const size_t	plane_size		= static_cast<size_t>(width) * static_cast<size_t>(height);
+	const float		padding			= 127.0f / 255.0f;
+	const float		scale			= 1.0f / 255.0f;
+
+	// Same pixel centers as cv::resize() with INTER_LINEAR.  For each output column or row, find the 2 input pixels to
+	// interpolate between, and the weight of the 2nd one.  When the sizes match, this is the pixel itself with no weight.
+	struct Lookup
+	{
+		int		first;
+		int		second;
+		float	weight;
+	};
+	const auto create_lookups = [](const int output_size, const int input_size)
+	{
+		std::vector<Lookup> lookups(output_size);
+		const float factor = static_cast<float>(input_size) / static_cast<float>(output_size);
+		for (int idx = 0; idx < output_size; idx ++)
+		{
+			float pos = (input_size == output_size ? static_cast<float>(idx) : std::max(0.0f, (idx + 0.5f) * factor - 0.5f));
+			int first = static_cast<int>(pos);
+			if (first >= input_size - 1)
+			{
+				first	= input_size - 1;
+				pos		= static_cast<float>(first);
+			}
+			lookups[idx] = {first, std::min(first + 1, input_size - 1), pos - first};
+		}
+		return lookups;
+	};
+
+	// frames which are already the right size are common with cameras configured for the network dimensions
+	const bool same_size = (src.size() == roi.size());
+
+	auto columns = create_lookups(roi.width, src.cols);
+	const auto rows = create_lookups(roi.height, src.rows);
+	for (auto & column : columns)
+	{
+		// convert the columns to byte offsets within each row of the image
+		column.first	*= src_channels;
+		column.second	*= src_channels;
+	}
+
+	cv::parallel_for_(cv::Range(0, height),
+		[&](const cv::Range & range)
+		{
+			for (int y = range.start; y < range.end; y ++)
+			{
+				float * planes[3] = {nullptr, nullptr, nullptr};
+				for (int c = 0; c < channels; c ++)
+				{
+					planes[c] = dst + c * plane_size + static_cast<size_t>(y) * width;
+				}
+
+				if (y < roi.y or y >= roi.y + roi.height)
+				{
+					for (int c = 0; c < channels; c ++)
+					{
+						std::fill(planes[c], planes[c] + width, padding);
+					}
+					continue;
+				}
+
+				for (int c = 0; c < channels; c ++)
+				{
+					std::fill(planes[c], planes[c] + roi.x, padding);
+					std::fill(planes[c] + roi.x + roi.width, planes[c] + width, padding);
+					planes[c] += roi.x;
+				}
+
+				const Lookup & row = rows[y - roi.y];
+				const uint8_t * const top_row		= src.ptr<uint8_t>(row.first);
+				const uint8_t * const bottom_row	= src.ptr<uint8_t>(row.second);
+
+				for (int x = 0; x < roi.width; x ++)
+				{
+					const Lookup & column = columns[x];
+
+					float values[3];
+					if (same_size)
+					{
+						// no need to interpolate when the image isn't resized
+						for (int c = 0; c < src_channels; c ++)
+						{
+							values[c] = top_row[column.first + c] * scale;
+						}
+					}
+					else
+					{
+						for (int c = 0; c < src_channels; c ++)
+						{
+							const float top		= top_row	[column.first + c] + column.weight * (top_row	[column.second + c] - top_row	[column.first + c]);
+							const float bottom	= bottom_row[column.first + c] + column.weight * (bottom_row[column.second + c] - bottom_row[column.first + c]);
+							values[c] = (top + row.weight * (bottom - top)) * scale;
+						}
+					}
+
+					if (src_channels == 3 and channels == 3)
+					{
+						// BGR -> RGB
+						planes[0][x] = values[2];
+						planes[1][x] = values[1];
+						planes[2][x] = values[0];
+					}
+					else if (src_channels == 3)
+					{
+						// BGR -> greyscale, same weights as cv::COLOR_BGR2GRAY
+						planes[0][x] = 0.299f * values[2] + 0.587f * values[1] + 0.114f * values[0];
+					}
+					else
+					{
+						for (int c = 0; c < channels; c ++)
+						{
+							planes[c][x] = values[0];
+						}
+					}
+				}
+			}
+		});
+
+	return;
+}
+
+
 std::string DarkHelp::yolo_annotations_filename(const std::string & image_filename)
 {
 	// This would be so much easier if I could use std::filesystem from C++17, but I'm trying to limit the library to C++11.
@@ -857,6 +1053,104 @@ void DarkHelp::pixelate_rectangle(const cv::Mat & src, cv::Mat & dst, const cv::
 }
 
 
+namespace
+{
+	/** Get the number of pixelation cells across and down the rectangle, using the same cell sizes as
+	 * @ref DarkHelp::pixelate_rectangle().  The size is empty if the rectangle cannot be pixelated.
+	 */
+	cv::Size pixelation_cells(const cv::Mat & src, const cv::Rect & r, const int size)
+	{
+		if (src.empty()					or
+			r.area() <= 0				or
+			r.x < 0						or
+			r.y < 0						or
+			r.x + r.width	> src.cols	or
+			r.y + r.height	> src.rows	or
+			size < 5)
+		{
+			return cv::Size();
+		}
+
+		if (r.width < (size * 2) and r.height < (size * 2))
+		{
+			// small rectangles are a single cell
+			return cv::Size(1, 1);
+		}
+
+		return cv::Size(
+			static_cast<int>(std::ceil(r.width	/ static_cast<float>(size))),
+			static_cast<int>(std::ceil(r.height	/ static_cast<float>(size))));
+	}
+}
+
+
+void DarkHelp::pixelate_rectangle_average(const cv::Mat & src, cv::Mat & dst, const cv::Rect & r, const int size)
+{
+	const cv::Size cells = pixelation_cells(src, r, size);
+	if (cells.empty())
+	{
+		return;
+	}
+
+	if (dst.size() != src.size())
+	{
+		dst = src.clone();
+	}
+
+	cv::Mat averages;
+	cv::resize(src(r), averages, cells, 0.0, 0.0, cv::INTER_AREA);
+
+	cv::Mat roi = dst(r);
+	cv::resize(averages, roi, roi.size(), 0.0, 0.0, cv::INTER_NEAREST);
+
+	return;
+}
+
+
+void DarkHelp::pixelate_rectangles_average(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const std::set<int> & class_filter, const int size)
+{
+	VRect rects;
+	rects.reserve(prediction_results.size());
+	for (const auto & p : prediction_results)
+	{
+		if ((class_filter.empty() or class_filter.count(p.best_class) > 0) and not pixelation_cells(src, p.rect, size).empty())
+		{
+			rects.push_back(p.rect);
+		}
+	}
+
+	if (rects.empty())
+	{
+		return;
+	}
+
+	if (dst.size() != src.size())
+	{
+		dst = src.clone();
+	}
+
+	// the averages are all calculated before anything is written, so overlapping rectangles and src == dst both work
+	std::vector<cv::Mat> averages(rects.size());
+	cv::parallel_for_(cv::Range(0, static_cast<int>(rects.size())),
+		[&](const cv::Range & range)
+		{
+			for (int idx = range.start; idx < range.end; idx ++)
+			{
+				cv::resize(src(rects[idx]), averages[idx], pixelation_cells(src, rects[idx], size), 0.0, 0.0, cv::INTER_AREA);
+			}
+		});
+
+	// rectangles may overlap, so they're filled in the same order as the predictions
+	for (size_t idx = 0; idx < rects.size(); idx ++)
+	{
+		cv::Mat roi = dst(rects[idx]);
+		cv::resize(averages[idx], roi, roi.size(), 0.0, 0.0, cv::INTER_NEAREST);
+	}
+
+	return;
+}
+
+
 void DarkHelp::toggle_output_redirection()
 {
 	static int redirected_stdout	= -1;
@@ -901,24 +1195,6 @@ void DarkHelp::toggle_output_redirection()
 }
 
 
-namespace
-{
-	#pragma pack(push, 1)
-	struct Head
-	{
-		uint8_t header[4]; // short name + version
-		// uint16_t gives us a max file size of 64 KiB - 1, while most config files are a few KiB in size
-		uint16_t padding_size;
-		uint16_t cfg_size;
-		uint16_t names_size;
-		// uint32_t gives us a max file size of 4 GiB - 1, while most neural networks are a few MiB in size
-		uint32_t weights_size;
-	};
-	#pragma pack(pop)
-	static_assert(sizeof(Head) == 4 + 2 + 2 + 2 + 4); // 14 bytes
-}
-
-
 std::filesystem::path DarkHelp::combine(const std::string & key, const std::filesystem::path & cfg_filename, const std::filesystem::path & names_filename, const std::filesystem::path & weights_filename)
 {
 	if (not std::filesystem::exists(cfg_filename) or
@@ -937,64 +1213,70 @@ std::filesystem::path DarkHelp::combine(const std::string & key, const std::file
 
 	verify_cfg_and_weights(cfg, weights, names);
 
-	if (std::filesystem::file_size(cfg) > std::numeric_limits<decltype(Head::cfg_size)>::max())
-	{
-		throw std::logic_error("configuration file exceeds the size limit");
-	}
-	if (std::filesystem::file_size(names) > std::numeric_limits<decltype(Head::names_size)>::max())
-	{
-		throw std::logic_error("names file exceeds the size limit");
-	}
-	if (std::filesystem::file_size(weights) > std::numeric_limits<decltype(Head::weights_size)>::max())
+	/* When the bundle is not obfuscated, each section starts on a 4 KiB boundary so it can be used directly from the
+	 * mapped file.  Obfuscated sections always need to be decoded, so like version 1 bundles they are instead packed one
+	 * after the other, following a random amount of random padding.
+	 */
+	const bool obfuscated = not key.empty();
+	const uint32_t alignment = (obfuscated ? 1 : Bundle::kAlignment);
+	auto align = [alignment](const uint64_t offset) -> uint64_t
 	{
-		throw std::logic_error("weights file exceeds the size limit");
-	}
+		return (offset + alignment - 1) / alignment * alignment;
+	};
+
+	std::random_device rd;
+	std::mt19937 rng(rd());
+	const uint64_t padding_size = (obfuscated ? std::uniform_int_distribution<uint64_t>(10, 209)(rng) : 0);
 
-	Head head;
+	Bundle::HeadV2 head;
+	std::memset(&head, 0, sizeof(head));
 	head.header[0]		= 'D';	// "DH" = "DarkHelp"
 	head.header[1]		= 'H';
 	head.header[2]		= 0;		// major version
-	head.header[3]		= 1;		// minor version
-	head.padding_size	= 10 + (std::rand() % 200);
+	head.header[3]		= 2;		// minor version
+	head.head_size		= sizeof(head);
+	head.alignment		= alignment;
+	head.flags			= (obfuscated ? Bundle::kFlagObfuscated : 0);
 	head.cfg_size		= std::filesystem::file_size(cfg);
 	head.names_size		= std::filesystem::file_size(names);
 	head.weights_size	= std::filesystem::file_size(weights);
+	head.cfg_offset		= align(sizeof(head) + padding_size);
+	head.names_offset	= align(head.cfg_offset + head.cfg_size);
+	head.weights_offset	= align(head.names_offset + head.names_size); // the weights must be the last section
 
-	if (key.empty())
-	{
-		std::cout << "-> no obfuscation key" << std::endl;
-		head.padding_size = 0;
-	}
-
-	std::vector<uint8_t> buffer(2048, '\0'); // process 2 KiB chunks at a time
-	char * ptr = reinterpret_cast<char*>(buffer.data());
-	std::memcpy(ptr, &head, sizeof(head));
+	// skip the first few bytes (DH02, sizes, and flags) and obfuscate the section offsets and sizes
+	Bundle::HeadV2 obfuscated_head = head;
+	uint8_t * head_ptr = reinterpret_cast<uint8_t*>(&obfuscated_head);
+	obfuscate(key, Bundle::kPlainHeadSize, head_ptr + Bundle::kPlainHeadSize, head_ptr + Bundle::kPlainHeadSize, sizeof(head) - Bundle::kPlainHeadSize);
 
-	// skip the first 4 bytes (DH01) and obfuscate the rest of the head structure
-	if (not key.empty())
+	if (not obfuscated)
 	{
-		for (size_t idx = 4; idx < sizeof(head); idx ++)
-		{
-			ptr[idx] ^= key[idx % key.size()];
-		}
+		std::cout << "-> no obfuscation key" << std::endl;
 	}
 
 	std::filesystem::path output_filename = std::filesystem::path(cfg).replace_extension(".dh");
 	std::ofstream ofs(output_filename, std::ofstream::binary | std::ofstream::trunc);
-	ofs.write(ptr, sizeof(head));
+	ofs.write(reinterpret_cast<const char*>(&obfuscated_head), sizeof(obfuscated_head));
 
-	// next we generate and write the padding bytes
-	for (size_t idx = 0; idx < head.padding_size; idx ++)
-	{
-		ptr[idx] = std::rand() % 256;
-	}
-	ofs.write(ptr, head.padding_size);
+	std::vector<uint8_t> buffer(4 * 1024 * 1024); // process 4 MiB chunks at a time
+	char * ptr = reinterpret_cast<char*>(buffer.data());
 
-	// next comes the 3 files
-	for (const auto & filename : {cfg, names, weights})
+	// next comes the 3 files, each of which starts on an aligned offset
+	for (const auto & [filename, offset] : {std::make_pair(cfg, head.cfg_offset), std::make_pair(names, head.names_offset), std::make_pair(weights, head.weights_offset)})
 	{
 		std::cout << "-> adding " << filename << std::endl;
 
+		// the padding is random when obfuscated, otherwise zero
+		std::vector<char> padding(offset - static_cast<uint64_t>(ofs.tellp()), '\0');
+		if (obfuscated)
+		{
+			for (auto & c : padding)
+			{
+				c = static_cast<char>(rng());
+			}
+		}
+		ofs.write(padding.data(), padding.size());
+
 		size_t total_bytes_read = 0;
 		std::ifstream ifs(filename, std::ifstream::in | std::ifstream::binary);
 
@@ -1003,13 +1285,7 @@ std::filesystem::path DarkHelp::combine(const std::string & key, const std::file
 			ifs.read(ptr, buffer.size());
 			const size_t count = ifs.gcount();
 
-			if (not key.empty())
-			{
-				for (size_t idx = 0; idx < count; idx ++)
-				{
-					ptr[idx] ^= key[(total_bytes_read + idx) % key.size()];
-				}
-			}
+			obfuscate(key, total_bytes_read, ptr, ptr, count);
 
 			ofs.write(ptr, count);
 			total_bytes_read += count;
@@ -1021,51 +1297,94 @@ std::filesystem::path DarkHelp::combine(const std::string & key, const std::file
 		}
 	}
 
+	if (not ofs.good())
+	{
+		throw std::runtime_error("failed to write the bundle " + output_filename.string());
+	}
+
 	return output_filename;
 }
 
 
-void DarkHelp::extract(const std::string & key, const std::filesystem::path & bundle, std::filesystem::path & cfg_filename, std::filesystem::path & names_filename, std::filesystem::path & weights_filename)
+void DarkHelp::obfuscate(const std::string & key, const size_t offset, const void * src, void * dst, const size_t len)
 {
-	if (not std::filesystem::exists(bundle) or
-		not std::filesystem::is_regular_file(bundle))
+	const uint8_t * in	= reinterpret_cast<const uint8_t*>(src);
+	uint8_t * out		= reinterpret_cast<uint8_t*>(dst);
+
+	if (key.empty())
 	{
-		throw std::invalid_argument("DarkHelp bundle does not exist or is not a regular file (" + bundle.string() + ")");
+		if (in != out)
+		{
+			std::memmove(out, in, len);
+		}
+		return;
 	}
 
-	cfg_filename	.clear();
-	names_filename	.clear();
-	weights_filename.clear();
+	const size_t key_size = key.size();
+	const size_t lane_size = 64;
 
-	std::ifstream ifs(bundle.string(), std::ifstream::binary | std::ifstream::in);
+	if (len < 4 * lane_size)
+	{
+		// not worth building the pattern for tiny blocks such as the v1 header
+		for (size_t idx = 0; idx < len; idx ++)
+		{
+			out[idx] = in[idx] ^ static_cast<uint8_t>(key[(offset + idx) % key_size]);
+		}
+		return;
+	}
 
-	Head head;
-	char * ptr = reinterpret_cast<char*>(&head);
-	ifs.read(ptr, sizeof(Head));
-	if (head.header[0] != 'D'	or
-		head.header[1] != 'H'	or
-		head.header[2] != 0		or
-		head.header[3] != 1		)
+	// Repeat the key until the length is a multiple of both the key size and the lane size.  The pattern can then be
+	// re-applied every pattern_size bytes, and each lane always lines up with the same 64 bytes of the pattern.
+	const size_t pattern_size = std::lcm(key_size, lane_size);
+	std::vector<uint8_t> pattern(pattern_size);
+	for (size_t idx = 0; idx < pattern_size; idx ++)
 	{
-		throw std::invalid_argument("invalid DarkHelp bundle (version mismatch): " + bundle.string());
+		pattern[idx] = key[(offset + idx) % key_size];
 	}
 
-	// see if the rest of the header makes sense
-	if (not key.empty())
+	size_t idx = 0;
+	size_t pattern_idx = 0;
+	while (idx + lane_size <= len)
 	{
-		for (size_t idx = 4; idx < sizeof(head); idx ++)
+		// memcpy() to and from local variables lets the compiler use wide unaligned loads and stores
+		uint64_t lane[lane_size / sizeof(uint64_t)];
+		uint64_t mask[lane_size / sizeof(uint64_t)];
+		std::memcpy(lane, in + idx, lane_size);
+		std::memcpy(mask, pattern.data() + pattern_idx, lane_size);
+		for (size_t i = 0; i < lane_size / sizeof(uint64_t); i ++)
+		{
+			lane[i] ^= mask[i];
+		}
+		std::memcpy(out + idx, lane, lane_size);
+
+		idx += lane_size;
+		pattern_idx += lane_size;
+		if (pattern_idx == pattern_size)
 		{
-			ptr[idx] ^= key[idx % key.size()];
+			pattern_idx = 0;
 		}
 	}
 
-	const size_t expected_filesize = sizeof(Head) + head.padding_size + head.cfg_size + head.names_size + head.weights_size;
-	const size_t actual_filesize = std::filesystem::file_size(bundle);
-	if (expected_filesize != actual_filesize)
+	// the last few bytes which don't fill an entire lane
+	while (idx < len)
 	{
-		throw std::invalid_argument("invalid DarkHelp bundle (size mismatch): " + bundle.string());
+		out[idx] = in[idx] ^ pattern[pattern_idx];
+		idx ++;
+		pattern_idx ++;
 	}
 
+	return;
+}
+
+
+void DarkHelp::extract(const std::string & key, const std::filesystem::path & bundle, std::filesystem::path & cfg_filename, std::filesystem::path & names_filename, std::filesystem::path & weights_filename)
+{
+	cfg_filename	.clear();
+	names_filename	.clear();
+	weights_filename.clear();
+
+	Bundle b(bundle, key);
+
 	// once we get here, assume that everything will be OK
 
 	auto generate_tmp_filename = []() -> std::filesystem::path
@@ -1094,39 +1413,15 @@ void DarkHelp::extract(const std::string & key, const std::filesystem::path & bu
 	names_filename		= generate_tmp_filename().replace_extension(".names");
 	weights_filename	= generate_tmp_filename().replace_extension(".weights");
 
-	std::vector<uint8_t> buffer(2048, '\0'); // process 2 KiB chunks at a time
-	ptr = reinterpret_cast<char*>(buffer.data());
-
-	auto extract_file = [&](const size_t offset, const size_t len, const std::filesystem::path filename)
+	auto extract_file = [](const std::string_view data, const std::filesystem::path filename)
 	{
-//		std::cout << "-> saving " << len << " bytes to " << filename.string() << std::endl;
-
-		ifs.seekg(offset);
-
-		size_t bytes_processed = 0;
 		std::ofstream ofs(filename, std::ofstream::binary | std::ofstream::trunc);
-		while (ifs and bytes_processed < len)
-		{
-			const size_t bytes_remaining = len - bytes_processed;
-			ifs.read(ptr, std::min(bytes_remaining, buffer.size()));
-			const size_t count = ifs.gcount();
-
-			if (not key.empty())
-			{
-				for (size_t idx = 0; idx < count; idx ++)
-				{
-					ptr[idx] ^= key[(bytes_processed + idx) % key.size()];
-				}
-			}
-
-			ofs.write(ptr, count);
-			bytes_processed += count;
-		}
+		ofs.write(data.data(), data.size());
 	};
 
-	extract_file(sizeof(Head) + head.padding_size,										head.cfg_size,		cfg_filename		);
-	extract_file(sizeof(Head) + head.padding_size + head.cfg_size,						head.names_size,	names_filename		);
-	extract_file(sizeof(Head) + head.padding_size + head.cfg_size + head.names_size,	head.weights_size,	weights_filename	);
+	extract_file(b.cfg()		, cfg_filename		);
+	extract_file(b.names()		, names_filename	);
+	extract_file(b.weights()	, weights_filename	);
 
 	return;
 }
@@ -93,6 +93,15 @@ namespace DarkHelp
 	 */
 	size_t edit_cfg_file(const std::string & cfg_filename, MStr m);
 
+	/** Similar to @ref DarkHelp::edit_cfg_file(), but modifies the content of a configuration file which has already been
+	 * loaded into memory.  Nothing is written to disk.
+	 *
+	 * @returns The number of lines that were modified or had to be inserted into the configuration.
+	 *
+	 * @since 2026-10-16
+	 */
+	size_t edit_cfg_text(std::string & cfg, MStr m);
+
 	/** Automatically called by @ref DarkHelp::NN::predict_internal() when @ref DarkHelp::Config::fix_out_of_bound_values
 	 * has been set.
 	 */
@@ -130,6 +139,28 @@ namespace DarkHelp
 	 */
 	cv::Mat slow_resize_ignore_aspect_ratio(const cv::Mat & mat, const cv::Size & desired_size);
 
+	/** Prepare the input of a neural network in a single pass over the image.  The image is resized with bilinear
+	 * interpolation, converted from BGR to RGB, normalized to @p 0.0-1.0, and written as planar floats (all the red
+	 * values, then all the green values, then all the blue values) directly into @p dst.  The rows are processed in
+	 * parallel.  This replaces the separate calls to @p cv::resize(), @p cv::cvtColor(), and the conversion to @p float,
+	 * each of which would otherwise allocate and write a new image.
+	 *
+	 * @param [in] src The image, which must be either @p CV_8UC3 (BGR) or @p CV_8UC1 (greyscale).  If the image is
+	 * already the same size as @p roi then it is converted without resizing.
+	 * @param [out] dst The planar output, which must be large enough for @p channels * @p network_size.area() floats.
+	 * @param [in] network_size The width and height of each plane in @p dst.
+	 * @param [in] channels The number of planes to write, either @p 3 (RGB) or @p 1 (greyscale).  Greyscale images are
+	 * copied to all 3 planes, and BGR images are converted to greyscale when a single plane is needed.
+	 * @param [in] roi Where the image is written within the planes.  This is normally the entire network, but may be
+	 * smaller when the image is letterboxed.  Everything outside of @p roi is set to grey (@p 127/255).
+	 *
+	 * @see @ref DarkHelp::Config::use_fast_image_resize
+	 * @see @ref DarkHelp::Config::use_letterbox
+	 *
+	 * @since 2026-10-16
+	 */
+	void fill_network_input(const cv::Mat & src, float * dst, const cv::Size & network_size, const int channels, const cv::Rect & roi);
+
 	/** Given an image filename, get the corresponding filename where the YOLO annotations should be saved.
 	 * This will be the same as the image filename but with a @p .txt file extension.
 	 * If the filename provided already ends in @p .txt, then the original filename will be returned.
@@ -254,6 +285,28 @@ namespace DarkHelp
 	 */
 	void pixelate_rectangle(const cv::Mat & src, cv::Mat & dst, const cv::Rect & r, const int size = 15);
 
+	/** Similar to @ref DarkHelp::pixelate_rectangle(), but each cell is filled with the average colour of the cell
+	 * instead of the dominant colour.  The whole rectangle is pixelated with 2 calls to @p cv::resize(), the first with
+	 * @p cv::INTER_AREA to get the average of each cell, and the second with @p cv::INTER_NEAREST to fill in the cells.
+	 *
+	 * @see @ref DarkHelp::Config::annotation_pixelate_average
+	 *
+	 * @since 2026-10-16
+	 */
+	void pixelate_rectangle_average(const cv::Mat & src, cv::Mat & dst, const cv::Rect & r, const int size = 15);
+
+	/** Pixelate the predictions using @ref DarkHelp::pixelate_rectangle_average().  Only the predictions where the class
+	 * ID matches a value in the class filter are pixelated, unless the class filter is empty.
+	 *
+	 * The average colours of all the rectangles are calculated in parallel before any of the rectangles are modified,
+	 * so @p src and @p dst may be the same image.
+	 *
+	 * @see @ref DarkHelp::Config::annotation_pixelate_average
+	 *
+	 * @since 2026-10-16
+	 */
+	void pixelate_rectangles_average(const cv::Mat & src, cv::Mat & dst, const PredictionResults & prediction_results, const std::set<int> & class_filter, const int size = 15);
+
 	/** Toggle STDOUT and STDERR output redirection.
 	 *
 	 * The first time this is called, both @p STDOUT and @p STDERR will be redirected to @p /dev/null (on Linux) or @p NUL:
@@ -270,6 +323,14 @@ namespace DarkHelp
 	/** Combine together the 3 files that make up a neural network, and obfuscate them using the given key phrase.
 	 * Normally, this is done using the @p DarkHelpCombine command line tool.
 	 *
+	 * The output is a version 2 bundle, which can be memory-mapped and loaded without extracting the files.  When the key
+	 * is empty, each of the 3 files starts on a 4 KiB boundary so they can be used directly from the mapped file.  When
+	 * obfuscated, the section offsets and sizes are obfuscated and the files are preceded by random padding, the same as
+	 * version 1 bundles.  Nothing derived from the key is stored in the bundle.  See @ref DarkHelp::Bundle.
+	 *
+	 * @warning Older versions of %DarkHelp can only read version 1 bundles, and will reject bundles created by this
+	 * version of %DarkHelp.
+	 *
 	 * @note This is not encryption.  It only performs obfuscation if the key is not empty.  If the key is empty, then no
 	 * obfuscation is performed but the 3 files are still bundled together.
 	 *
@@ -286,10 +347,31 @@ namespace DarkHelp
 	 */
 	std::filesystem::path combine(const std::string & key, const std::filesystem::path & cfg_filename, const std::filesystem::path & names_filename, const std::filesystem::path & weights_filename);
 
-	/** Extract the 3 files that make up a neural network.
+	/** Apply the bundle obfuscation to a block of memory.  Each byte is XORed with the byte of the key at the same position,
+	 * where the key is repeated as many times as needed.  This is the obfuscation used by both version 1 and version 2
+	 * bundles, so applying it a second time with the same key restores the original data.
+	 *
+	 * Large blocks are processed 64 bytes at a time using a copy of the key which has been repeated to a multiple of 64
+	 * bytes, which the compiler can turn into SIMD instructions.
+	 *
+	 * @param [in] key The key phrase.  If empty, the data is copied as-is.
+	 * @param [in] offset The position of @p src within the file or section, which determines where in the key to start.
+	 * @param [in] src The data to obfuscate (or de-obfuscate).
+	 * @param [out] dst Where to store the results.  This may be the same as @p src.
+	 * @param [in] len The number of bytes to process.
+	 *
+	 * @see @ref DarkHelp::combine()
+	 * @see @ref DarkHelp::Bundle
+	 *
+	 * @since 2026-10-16
+	 */
+	void obfuscate(const std::string & key, const size_t offset, const void * src, void * dst, const size_t len);
+
+	/** Extract the 3 files that make up a neural network.  Both version 1 and version 2 bundles are supported.
 	 *
 	 * @note Usually, this does not need to be called directly.  Instead, see the @ref DarkHelp::NN::NN() constructor
-	 * which takes the bundle filename and the key phrase.
+	 * which takes the bundle filename and the key phrase, and loads the neural network without extracting the files.
+	 * To access the files in memory, see @ref DarkHelp::Bundle.
 	 *
 	 * @see @ref DarkHelp::combine()
 	 *
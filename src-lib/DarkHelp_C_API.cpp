@@ -17,6 +17,36 @@
  */
 
 
+/** Each @ref DarkHelpPtr handed out by the @p C API points to one of these objects.  Everything returned to the caller
+ * is stored within the handle itself, so different handles can safely be used at the same time from different threads.
+ */
+struct DarkHelpCAPIHandle
+{
+	DarkHelpCAPIHandle()
+	{
+		return;
+	}
+
+	DarkHelpCAPIHandle(const std::string & fn1, const std::string & fn2, const std::string & fn3) :
+		nn(fn1, fn2, fn3)
+	{
+		return;
+	}
+
+	/// The neural network used by this handle.
+	DarkHelp::NN nn;
+
+	/// The buffer returned by @ref GetPredictionResults().  It remains valid until the next call with the same handle.
+	std::string prediction_results;
+};
+
+
+static inline DarkHelpCAPIHandle * get_handle(DarkHelpPtr ptr)
+{
+	return reinterpret_cast<DarkHelpCAPIHandle*>(ptr);
+}
+
+
 const char * DarkHelpVersion()
 {
 	const static auto version = DarkHelp::version();
@@ -53,7 +83,7 @@ DarkHelpPtr CreateDarkHelpNN(const char * const fn1, const char * const fn2, con
 		std::string s1 = fn1;
 		std::string s2 = fn2;
 		std::string s3 = fn3;
-		ptr = reinterpret_cast<DarkHelpPtr>(new DarkHelp::NN(s1, s2, s3));
+		ptr = reinterpret_cast<DarkHelpPtr>(new DarkHelpCAPIHandle(s1, s2, s3));
 	}
 	catch (const std::exception & e)
 	{
@@ -64,6 +94,34 @@ DarkHelpPtr CreateDarkHelpNN(const char * const fn1, const char * const fn2, con
 }
 
 
+DarkHelpPtr CreateDarkHelpNNFromMemory(const char * const cfg, const size_t cfg_size, const char * const names, const size_t names_size, const void * const weights, const size_t weights_size)
+{
+	if (cfg == nullptr or weights == nullptr or (names == nullptr and names_size > 0))
+	{
+		std::cerr << "ignoring call to " << __func__ << " with a null pointer" << std::endl;
+		return nullptr;
+	}
+
+	DarkHelpCAPIHandle * handle = nullptr;
+	try
+	{
+		handle = new DarkHelpCAPIHandle;
+		handle->nn.init_from_memory(
+			std::string_view(cfg, cfg_size),
+			std::string_view(names ? names : "", names_size),
+			std::string_view(reinterpret_cast<const char *>(weights), weights_size));
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		delete handle;
+		handle = nullptr;
+	}
+
+	return reinterpret_cast<DarkHelpPtr>(handle);
+}
+
+
 void DestroyDarkHelpNN(DarkHelpPtr ptr)
 {
 	if (ptr == nullptr)
@@ -74,9 +132,9 @@ void DestroyDarkHelpNN(DarkHelpPtr ptr)
 
 	try
 	{
-		DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+		DarkHelpCAPIHandle * handle = get_handle(ptr);
 
-		delete nn;
+		delete handle;
 	}
 	catch (const std::exception & e)
 	{
@@ -98,7 +156,7 @@ int PredictFN(DarkHelpPtr ptr, const char * const image_filename)
 	int size = 0;
 	try
 	{
-		DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+		DarkHelp::NN * nn = &get_handle(ptr)->nn;
 
 		nn->predict(image_filename);
 		size = (int)nn->prediction_results.size();
@@ -148,7 +206,7 @@ int Predict(DarkHelpPtr ptr, const int width, const int height, uint8_t * image,
 	int number_of_predictions = 0;
 	try
 	{
-		DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+		DarkHelp::NN * nn = &get_handle(ptr)->nn;
 
 		const auto type = CV_8UC(channels);
 		cv::Mat mat(height, width, type, static_cast<void*>(image));
@@ -166,20 +224,160 @@ int Predict(DarkHelpPtr ptr, const int width, const int height, uint8_t * image,
 }
 
 
-const char * GetPredictionResults(DarkHelpPtr ptr)
+int PredictEx(DarkHelpPtr ptr, const int width, const int height, const int stride, const DarkHelpPixelFormat format, const uint8_t * image, const int roi_x, const int roi_y, const int roi_width, const int roi_height)
 {
-	static std::string buffer;
-	buffer = "\0";
+	if (ptr == nullptr)
+	{
+		std::cerr << "ignoring call to " << __func__ << " with a null pointer" << std::endl;
+		return -1;
+	}
+
+	if (image == nullptr)
+	{
+		std::cerr << "ignoring call to " << __func__ << " with a null image data pointer" << std::endl;
+		return -1;
+	}
+
+	if (width <= 0 or height <= 0)
+	{
+		std::cerr << "ignoring call to " << __func__ << " with invalid image width and height" << std::endl;
+		return -1;
+	}
+
+	int bytes_per_pixel	= 0;
+	int cv_type			= 0;
+	switch (format)
+	{
+		case DarkHelpPixelFormatBGR:	bytes_per_pixel = 3; cv_type = CV_8UC3; break;
+		case DarkHelpPixelFormatRGB:	bytes_per_pixel = 3; cv_type = CV_8UC3; break;
+		case DarkHelpPixelFormatBGRA:	bytes_per_pixel = 4; cv_type = CV_8UC4; break;
+		case DarkHelpPixelFormatGRAY:	bytes_per_pixel = 1; cv_type = CV_8UC1; break;
+		case DarkHelpPixelFormatNV12:	bytes_per_pixel = 1; cv_type = CV_8UC1; break;
+		case DarkHelpPixelFormatYUYV:	bytes_per_pixel = 2; cv_type = CV_8UC2; break;
+	}
+	if (bytes_per_pixel == 0)
+	{
+		std::cerr << "ignoring call to " << __func__ << " with unknown pixel format " << static_cast<int>(format) << std::endl;
+		return -1;
+	}
+
+	const bool is_yuv = (format == DarkHelpPixelFormatNV12 or format == DarkHelpPixelFormatYUYV);
+	if (is_yuv and (width % 2 or (format == DarkHelpPixelFormatNV12 and height % 2)))
+	{
+		std::cerr << "ignoring call to " << __func__ << " with odd image dimensions for a YUV pixel format" << std::endl;
+		return -1;
+	}
+
+	const size_t step = (stride > 0 ? stride : width * bytes_per_pixel);
+	if (step < static_cast<size_t>(width * bytes_per_pixel))
+	{
+		std::cerr << "ignoring call to " << __func__ << " with a stride smaller than the image width" << std::endl;
+		return -1;
+	}
+
+	cv::Rect roi(0, 0, width, height);
+	if (roi_width > 0 and roi_height > 0)
+	{
+		roi = cv::Rect(roi_x, roi_y, roi_width, roi_height) & roi;
+		if (is_yuv)
+		{
+			// chroma is subsampled horizontally (and vertically for NV12) so the RoI must start and end on even coordinates
+			const int x = roi.x & ~1;
+			const int y = (format == DarkHelpPixelFormatNV12 ? roi.y & ~1 : roi.y);
+			roi.width	= (roi.width + roi.x - x) & ~1;
+			roi.height	= (format == DarkHelpPixelFormatNV12 ? (roi.height + roi.y - y) & ~1 : roi.height);
+			roi.x		= x;
+			roi.y		= y;
+		}
+		if (roi.empty())
+		{
+			std::cerr << "ignoring call to " << __func__ << " with a region of interest outside of the image" << std::endl;
+			return -1;
+		}
+	}
+
+	int number_of_predictions = 0;
+	try
+	{
+		DarkHelp::NN * nn = &get_handle(ptr)->nn;
+
+		// none of these cv::Mat objects copy the image -- they point directly to the caller's image data
+		uint8_t * data = const_cast<uint8_t *>(image);
+		const cv::Mat full(height, width, cv_type, data, step);
+		const cv::Mat src = full(roi);
 
+		cv::Mat mat;
+		switch (format)
+		{
+			case DarkHelpPixelFormatBGR:
+			{
+				mat = src;
+				break;
+			}
+			case DarkHelpPixelFormatRGB:
+			{
+				cv::cvtColor(src, mat, cv::COLOR_RGB2BGR);
+				break;
+			}
+			case DarkHelpPixelFormatBGRA:
+			{
+				cv::cvtColor(src, mat, cv::COLOR_BGRA2BGR);
+				break;
+			}
+			case DarkHelpPixelFormatGRAY:
+			{
+				if (nn->image_channels() == 1)
+				{
+					mat = src;
+				}
+				else
+				{
+					cv::cvtColor(src, mat, cv::COLOR_GRAY2BGR);
+				}
+				break;
+			}
+			case DarkHelpPixelFormatYUYV:
+			{
+				cv::cvtColor(src, mat, cv::COLOR_YUV2BGR_YUYV);
+				break;
+			}
+			case DarkHelpPixelFormatNV12:
+			{
+				const cv::Mat uv(height / 2, width / 2, CV_8UC2, data + step * height, step);
+				const cv::Rect uv_roi(roi.x / 2, roi.y / 2, roi.width / 2, roi.height / 2);
+				cv::cvtColorTwoPlane(src, uv(uv_roi), mat, cv::COLOR_YUV2BGR_NV12);
+				break;
+			}
+		}
+
+		nn->predict(mat);
+
+		number_of_predictions = (int)nn->prediction_results.size();
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << e.what() << std::endl;
+	}
+
+	return number_of_predictions;
+}
+
+
+const char * GetPredictionResults(DarkHelpPtr ptr)
+{
 	if (ptr == nullptr)
 	{
 		std::cerr << "ignoring call to " << __func__ << " with a null pointer" << std::endl;
-		return buffer.c_str();
+		return "";
 	}
 
+	// the buffer is specific to this handle, so other handles can be used at the same time on other threads
+	std::string & buffer = get_handle(ptr)->prediction_results;
+	buffer.clear();
+
 	try
 	{
-		DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+		DarkHelp::NN * nn = &get_handle(ptr)->nn;
 
 		nlohmann::json json;
 		json["file"][0]["count"]				= nn->prediction_results.size();
@@ -237,10 +435,16 @@ const char * GetPredictionResults(DarkHelpPtr ptr)
 			}
 		}
 
+		// std::localtime() uses a static buffer which is not thread-safe
 		const std::time_t tt = std::time(nullptr);
-		auto lt = std::localtime(&tt);
+		std::tm lt;
+		#ifdef WIN32
+		localtime_s(&lt, &tt);
+		#else
+		localtime_r(&tt, &lt);
+		#endif
 		char time_buffer[50];
-		std::strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S %z", lt);
+		std::strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S %z", &lt);
 		json["timestamp"]["epoch"] = tt;
 		json["timestamp"]["text"] = time_buffer;
 
@@ -255,6 +459,57 @@ const char * GetPredictionResults(DarkHelpPtr ptr)
 }
 
 
+int GetPredictionResultsArray(DarkHelpPtr ptr, DarkHelpPredictionResult * results, const int max_results)
+{
+	if (ptr == nullptr)
+	{
+		std::cerr << "ignoring call to " << __func__ << " with a null pointer" << std::endl;
+		return -1;
+	}
+
+	if (results == nullptr and max_results > 0)
+	{
+		std::cerr << "ignoring call to " << __func__ << " with a null results array" << std::endl;
+		return -1;
+	}
+
+	int number_of_predictions = -1;
+	try
+	{
+		DarkHelp::NN * nn = &get_handle(ptr)->nn;
+
+		const auto & predictions = nn->prediction_results;
+		number_of_predictions = static_cast<int>(predictions.size());
+
+		const int count = std::min(number_of_predictions, std::max(0, max_results));
+		for (int idx = 0; idx < count; idx ++)
+		{
+			const auto & pred	= predictions[idx];
+			auto & r			= results[idx];
+
+			r.best_class		= pred.best_class;
+			r.best_probability	= pred.best_probability;
+			r.x					= pred.rect.x;
+			r.y					= pred.rect.y;
+			r.width				= pred.rect.width;
+			r.height			= pred.rect.height;
+			r.center_x			= pred.original_point.x;
+			r.center_y			= pred.original_point.y;
+			r.normalized_width	= pred.original_size.width;
+			r.normalized_height	= pred.original_size.height;
+			r.tile				= pred.tile;
+			r.object_id			= pred.object_id;
+		}
+	}
+	catch (const std::exception & e)
+	{
+		std::cerr << e.what() << std::endl;
+	}
+
+	return number_of_predictions;
+}
+
+
 void Annotate(DarkHelpPtr ptr, const char * const output_image_filename)
 {
 	/* Links to pages to dig into if we want to pass cv::Mat objects between C++ and Python:
@@ -281,7 +536,7 @@ void Annotate(DarkHelpPtr ptr, const char * const output_image_filename)
 
 	try
 	{
-		DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+		DarkHelp::NN * nn = &get_handle(ptr)->nn;
 		cv::Mat mat = nn->annotate();
 
 		std::string fn = output_image_filename;
@@ -321,7 +576,7 @@ float SetThreshold(DarkHelpPtr ptr, float threshold)
 		return -1.0f;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(threshold, nn->config.threshold);
 
 	return threshold;
@@ -336,7 +591,7 @@ float SetNonMaximalSuppression(DarkHelpPtr ptr, float nms)
 		return -1.0f;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(nms, nn->config.non_maximal_suppression_threshold);
 
 	return nms;
@@ -351,7 +606,7 @@ bool EnableNamesIncludePercentage(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.names_include_percentage);
 
 	return enabled;
@@ -366,7 +621,7 @@ bool EnableAnnotationAutoHideLabels(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.annotation_auto_hide_labels);
 
 	return enabled;
@@ -381,7 +636,7 @@ bool EnableAnnotationSuppressAllLabels(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.annotation_suppress_all_labels);
 
 	return enabled;
@@ -396,7 +651,7 @@ float SetAnnotationShadePredictions(DarkHelpPtr ptr, float shading)
 		return -1.0f;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(shading, nn->config.annotation_shade_predictions);
 
 	return shading;
@@ -411,7 +666,7 @@ bool EnableIncludeAllNames(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.include_all_names);
 
 	return enabled;
@@ -426,7 +681,7 @@ double SetAnnotationFontScale(DarkHelpPtr ptr, double scale)
 		return -1.0;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(scale, nn->config.annotation_font_scale);
 
 	return scale;
@@ -441,7 +696,7 @@ int SetAnnotationFontThickness(DarkHelpPtr ptr, int thickness)
 		return -1;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(thickness, nn->config.annotation_font_thickness);
 
 	return thickness;
@@ -456,7 +711,7 @@ int SetAnnotationLineThickness(DarkHelpPtr ptr, int thickness)
 		return -1;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(thickness, nn->config.annotation_line_thickness);
 
 	return thickness;
@@ -471,7 +726,7 @@ bool EnableAnnotationIncludeDuration(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.annotation_include_duration);
 
 	return enabled;
@@ -486,7 +741,7 @@ bool EnableAnnotationIncludeTimestamp(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.annotation_include_timestamp);
 
 	return enabled;
@@ -501,7 +756,7 @@ bool EnableAnnotationPixelate(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.annotation_pixelate_enabled);
 
 	return enabled;
@@ -516,7 +771,7 @@ int SetAnnotationPixelateSize(DarkHelpPtr ptr, int size)
 		return -1;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(size, nn->config.annotation_pixelate_size);
 
 	return size;
@@ -531,7 +786,7 @@ bool EnableTiles(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.enable_tiles);
 
 	return enabled;
@@ -546,7 +801,7 @@ bool EnableCombineTilePredictions(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.combine_tile_predictions);
 
 	return enabled;
@@ -561,7 +816,7 @@ bool EnableOnlyCombineSimilarPredictions(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.only_combine_similar_predictions);
 
 	return enabled;
@@ -576,7 +831,7 @@ float SetTileEdgeFactor(DarkHelpPtr ptr, float factor)
 		return -1.0f;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(factor, nn->config.tile_edge_factor);
 
 	return factor;
@@ -591,7 +846,7 @@ float SetTileRectFactor(DarkHelpPtr ptr, float factor)
 		return -1.0f;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(factor, nn->config.tile_rect_factor);
 
 	return factor;
@@ -606,7 +861,7 @@ bool EnableSnapping(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.snapping_enabled);
 
 	return enabled;
@@ -621,7 +876,7 @@ int SetBinaryThresholdBlockSize(DarkHelpPtr ptr, int blocksize)
 		return -1;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(blocksize, nn->config.binary_threshold_block_size);
 
 	return blocksize;
@@ -636,7 +891,7 @@ double SetBinaryThresholdConstant(DarkHelpPtr ptr, double threshold)
 		return -1.0;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(threshold, nn->config.binary_threshold_constant);
 
 	return threshold;
@@ -651,7 +906,7 @@ int SetSnappingHorizontalTolerance(DarkHelpPtr ptr, int tolerance)
 		return -1;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(tolerance, nn->config.snapping_horizontal_tolerance);
 
 	return tolerance;
@@ -666,7 +921,7 @@ int SetSnappingVerticalTolerance(DarkHelpPtr ptr, int tolerance)
 		return -1;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(tolerance, nn->config.snapping_vertical_tolerance);
 
 	return tolerance;
@@ -681,7 +936,7 @@ float SetSnappingLimitShrink(DarkHelpPtr ptr, float limit)
 		return -1.0f;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(limit, nn->config.snapping_limit_shrink);
 
 	return limit;
@@ -696,7 +951,7 @@ float SetSnappingLimitGrow(DarkHelpPtr ptr, float limit)
 		return -1.0f;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(limit, nn->config.snapping_limit_grow);
 
 	return limit;
@@ -711,8 +966,23 @@ bool EnableUseFastImageResize(DarkHelpPtr ptr, bool enabled)
 		return false;
 	}
 
-	DarkHelp::NN * nn = reinterpret_cast<DarkHelp::NN*>(ptr);
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
 	std::swap(enabled, nn->config.use_fast_image_resize);
 
 	return enabled;
 }
+
+
+bool EnableLetterbox(DarkHelpPtr ptr, bool enabled)
+{
+	if (ptr == nullptr)
+	{
+		std::cerr << "ignoring call to " << __func__ << " with a null pointer" << std::endl;
+		return false;
+	}
+
+	DarkHelp::NN * nn = &get_handle(ptr)->nn;
+	std::swap(enabled, nn->config.use_letterbox);
+
+	return enabled;
+}
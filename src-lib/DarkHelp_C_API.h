@@ -22,6 +22,11 @@
  * Annotate(dh, "output.jpg");
  * DestroyDarkHelpNN(dh);
  * ~~~~
+ *
+ * The @p C API is reentrant across handles:  multiple @ref DarkHelpPtr handles may be used at the same time from
+ * different threads, since each handle has its own neural network and its own buffers.  A single handle must not be
+ * used by multiple threads at the same time.  The only exception is @ref ToggleOutputRedirection() which modifies
+ * @p STDOUT and @p STDERR for the entire process.
  */
 
 #ifdef __cplusplus
@@ -30,10 +35,11 @@ extern "C"
 #endif
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
-/** The @p DarkHelpPtr type is only used by the @p C and @p Python APIs.  It is a @ref DarkHelp::NN C++ object which
- * has been cast to a generic C-style @p void* type.
+/** The @p DarkHelpPtr type is only used by the @p C and @p Python APIs.  It is an opaque handle which contains a
+ * @ref DarkHelp::NN C++ object and the buffers returned to the caller, cast to a generic C-style @p void* type.
  * @see @ref CreateDarkHelpNN()
  * @see @ref DestroyDarkHelpNN()
  * @since December 2023
@@ -69,6 +75,23 @@ void ToggleOutputRedirection();
  */
 DarkHelpPtr CreateDarkHelpNN(const char * const fn1, const char * const fn2, const char * const fn3);
 
+/** Create a @ref DarkHelp::NN object from buffers in memory instead of from files.  The @p .cfg file is not modified on
+ * disk, and the buffers are not modified.  The buffers may be freed once this call returns.
+ *
+ * @param [in] cfg The content of the @p .cfg file.
+ * @param [in] cfg_size The number of bytes in @p cfg.
+ * @param [in] names The content of the @p .names file.  May be @p NULL if @p names_size is zero.
+ * @param [in] names_size The number of bytes in @p names.
+ * @param [in] weights The content of the @p .weights file.
+ * @param [in] weights_size The number of bytes in @p weights.
+ *
+ * When done with the neural network, remember to call @ref DestroyDarkHelpNN().
+ * @see @ref DarkHelp::NN::init_from_memory()
+ * @since October 2026
+ * @note This is part of the @ref CAPI, which is a simplified interface to the full @ref API.
+ */
+DarkHelpPtr CreateDarkHelpNNFromMemory(const char * const cfg, const size_t cfg_size, const char * const names, const size_t names_size, const void * const weights, const size_t weights_size);
+
 /** Destroy the neural network object previously created with @ref CreateDarkHelpNN().
  * @since December 2023
  * @note This is part of the @ref CAPI, which is a simplified interface to the full @ref API.
@@ -91,15 +114,93 @@ int PredictFN(DarkHelpPtr ptr, const char * const image_filename);
  */
 int Predict(DarkHelpPtr ptr, const int width, const int height, uint8_t * image, const int number_of_bytes);
 
+/** Pixel formats which can be used with @ref PredictEx().
+ * @since October 2026
+ * @note This is part of the @ref CAPI, which is a simplified interface to the full @ref API.
+ */
+typedef enum DarkHelpPixelFormat
+{
+	DarkHelpPixelFormatBGR	= 0,	///< 3 bytes per pixel, the same as OpenCV's @p CV_8UC3.
+	DarkHelpPixelFormatRGB	= 1,	///< 3 bytes per pixel.
+	DarkHelpPixelFormatBGRA	= 2,	///< 4 bytes per pixel.  The alpha channel is ignored.
+	DarkHelpPixelFormatGRAY	= 3,	///< 1 byte per pixel.
+	DarkHelpPixelFormatNV12	= 4,	///< Y plane of @p height rows, immediately followed by the interleaved UV plane of @p height/2 rows.  Both planes use the same stride.
+	DarkHelpPixelFormatYUYV	= 5		///< 2 bytes per pixel, also known as @p YUY2.
+} DarkHelpPixelFormat;
+
+/** Similar to @ref Predict(), but the image data may use any of the formats in @ref DarkHelpPixelFormat, may be
+ * padded at the end of each row, and inference can be limited to a region of interest.  This means frames from V4L2,
+ * GStreamer, or slices of @p numpy arrays can be used directly without first being copied into a tightly-packed BGR
+ * buffer.
+ *
+ * BGR images (and greyscale images when the network uses a single channel) are used as-is without making a copy.
+ * Other formats are converted to BGR in a single pass, and only the region of interest is converted.
+ *
+ * @param [in] ptr The handle returned by @ref CreateDarkHelpNN().
+ * @param [in] width The width of the full image in pixels.
+ * @param [in] height The height of the full image in pixels.
+ * @param [in] stride The number of bytes between the start of each row.  Use @p 0 if the rows are tightly packed.
+ * @param [in] format The pixel format of the image data.
+ * @param [in] image Pointer to the first byte of the image.
+ * @param [in] roi_x, roi_y, roi_width, roi_height Optional region of interest.  If @p roi_width or @p roi_height are
+ * zero, then the entire image is used.  For @p NV12 and @p YUYV the region of interest is aligned to even coordinates.
+ * Note the prediction results are relative to the region of interest, not the full image.
+ *
+ * @warning When the image data is used as-is, the memory must remain valid until after @ref Annotate() is called.
+ *
+ * @returns the number of predictions made, or @p -1 if the parameters are invalid.
+ * @since October 2026
+ * @note This is part of the @ref CAPI, which is a simplified interface to the full @ref API.
+ */
+int PredictEx(DarkHelpPtr ptr, const int width, const int height, const int stride, const DarkHelpPixelFormat format, const uint8_t * image, const int roi_x, const int roi_y, const int roi_width, const int roi_height);
+
 /** Get the last detection results from either @ref PredictFN() or @ref Predict().  The results will be formatted
  * as a JSON string.
- * @warning The @p char* buffer used to return the JSON is static, so don't attempt to use this function call simultaneously
- * from multiple threads, otherwise you risk corrupting the returned text or causing strange undefined behaviour.
+ * @note The @p char* buffer used to return the JSON belongs to the handle.  It remains valid until the next call to
+ * @p GetPredictionResults() with the same handle, or until the handle is destroyed.  Different handles can call this
+ * simultaneously from different threads.
  * @since December 2023
  * @note This is part of the @ref CAPI, which is a simplified interface to the full @ref API.
  */
 const char * GetPredictionResults(DarkHelpPtr ptr);
 
+/** Packed C structure used by @ref GetPredictionResultsArray() to return the prediction results without the overhead of
+ * creating and parsing JSON.  Because the structure is packed, it can be read directly by @p ctypes in Python, or with
+ * a @p numpy structured @p dtype.  @see @ref DarkHelp::PredictionResult
+ * @since October 2026
+ * @note This is part of the @ref CAPI, which is a simplified interface to the full @ref API.
+ */
+#pragma pack(push, 1)
+typedef struct DarkHelpPredictionResult
+{
+	int32_t		best_class;			///< @see @ref DarkHelp::PredictionResult::best_class
+	float		best_probability;	///< @see @ref DarkHelp::PredictionResult::best_probability
+	int32_t		x;					///< Top-left corner of the rectangle, in pixels.  @see @ref DarkHelp::PredictionResult::rect
+	int32_t		y;					///< Top-left corner of the rectangle, in pixels.  @see @ref DarkHelp::PredictionResult::rect
+	int32_t		width;				///< Width of the rectangle, in pixels.  @see @ref DarkHelp::PredictionResult::rect
+	int32_t		height;				///< Height of the rectangle, in pixels.  @see @ref DarkHelp::PredictionResult::rect
+	float		center_x;			///< Normalized X coordinate of the center.  @see @ref DarkHelp::PredictionResult::original_point
+	float		center_y;			///< Normalized Y coordinate of the center.  @see @ref DarkHelp::PredictionResult::original_point
+	float		normalized_width;	///< Normalized width.  @see @ref DarkHelp::PredictionResult::original_size
+	float		normalized_height;	///< Normalized height.  @see @ref DarkHelp::PredictionResult::original_size
+	int32_t		tile;				///< @see @ref DarkHelp::PredictionResult::tile
+	uint64_t	object_id;			///< @see @ref DarkHelp::PredictionResult::object_id
+} DarkHelpPredictionResult;
+#pragma pack(pop)
+
+/** Get the last detection results from either @ref PredictFN() or @ref Predict() as an array of
+ * @ref DarkHelpPredictionResult structures.  This is much faster than @ref GetPredictionResults() since no JSON is
+ * created.  The caller provides the array, and up to @p max_results entries will be filled in.
+ *
+ * To find out how large the array needs to be, call this with a @p nullptr array and @p max_results set to zero, or use
+ * the value returned by @ref PredictFN() or @ref Predict().
+ *
+ * @returns the total number of predictions, which may be larger than @p max_results, or @p -1 if an error occurred.
+ * @since October 2026
+ * @note This is part of the @ref CAPI, which is a simplified interface to the full @ref API.
+ */
+int GetPredictionResultsArray(DarkHelpPtr ptr, DarkHelpPredictionResult * results, const int max_results);
+
 /** Calls @ref DarkHelp::NN::annotate() on the last image and results from either @ref PredictFN() or @ref Predict().
  * The results will be saved to @p output_image_filename in either @p PNG or @p JPG format depending on the file
  * extension.
@@ -298,6 +399,13 @@ float SetSnappingLimitGrow(DarkHelpPtr ptr, float limit);
  */
 bool EnableUseFastImageResize(DarkHelpPtr ptr, bool enabled);
 
+/** Enable or disable @ref DarkHelp::Config::use_letterbox.
+ * @returns the previous value.
+ * @since October 2026
+ * @note This is part of the @ref CAPI, which is a simplified interface to the full @ref API.
+ */
+bool EnableLetterbox(DarkHelpPtr ptr, bool enabled);
+
 #ifdef __cplusplus
 }
 #endif
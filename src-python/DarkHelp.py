@@ -58,6 +58,22 @@ CreateDarkHelpNN = lib.CreateDarkHelpNN
 CreateDarkHelpNN.argtypes = (c_char_p, c_char_p, c_char_p)
 CreateDarkHelpNN.restype = c_void_p
 
+"""
+Create a %DarkHelp object from buffers in memory instead of from files, such as
+a network which has been downloaded or embedded within the application:
+
+    cfg = open("cars.cfg", "rb").read()
+    names = open("cars.names", "rb").read()
+    weights = open("cars.weights", "rb").read()
+    dh = DarkHelp.CreateDarkHelpNNFromMemory(cfg, len(cfg), names, len(names), weights, len(weights))
+
+Remember to call @ref DestroyDarkHelpNN() when done.
+@see @ref DarkHelp::NN::init_from_memory()
+"""
+CreateDarkHelpNNFromMemory = lib.CreateDarkHelpNNFromMemory
+CreateDarkHelpNNFromMemory.argtypes = (c_char_p, c_size_t, c_char_p, c_size_t, c_char_p, c_size_t)
+CreateDarkHelpNNFromMemory.restype = c_void_p
+
 """
 Destroy a %DarkHelp object created using @ref CreateDarkHelpNN().
 @see @ref DarkHelp::NN::~NN()
@@ -86,6 +102,32 @@ Predict = lib.Predict
 Predict.argtypes = [c_void_p, c_int, c_int, c_char_p, c_int]
 Predict.restype = c_int
 
+"""
+Pixel formats which can be used with @ref PredictEx().
+@see @ref DarkHelpPixelFormat
+"""
+DarkHelpPixelFormatBGR = 0
+DarkHelpPixelFormatRGB = 1
+DarkHelpPixelFormatBGRA = 2
+DarkHelpPixelFormatGRAY = 3
+DarkHelpPixelFormatNV12 = 4
+DarkHelpPixelFormatYUYV = 5
+
+"""
+Similar to @ref Predict(), but takes the stride, the pixel format, and an
+optional region of interest (use 0 for the RoI width and height to process
+the entire image).  The image is passed as a pointer, so a numpy array can
+be used directly with "arr.ctypes.data" without first being copied:
+
+    h, w = arr.shape[:2]
+    DarkHelp.PredictEx(dh, w, h, arr.strides[0], DarkHelp.DarkHelpPixelFormatRGB, arr.ctypes.data, 0, 0, 0, 0)
+
+@see @ref PredictEx()
+"""
+PredictEx = lib.PredictEx
+PredictEx.argtypes = [c_void_p, c_int, c_int, c_int, c_int, c_void_p, c_int, c_int, c_int, c_int]
+PredictEx.restype = c_int
+
 """
 Get the prediction results as a JSON string.
 """
@@ -93,6 +135,42 @@ GetPredictionResults = lib.GetPredictionResults
 GetPredictionResults.argtypes = [c_void_p]
 GetPredictionResults.restype = c_char_p
 
+"""
+Packed structure used to return prediction results without JSON.  This must
+match the C structure @ref DarkHelpPredictionResult.
+"""
+class DarkHelpPredictionResult(Structure):
+    _pack_ = 1
+    _fields_ = [
+        ("best_class",          c_int32),
+        ("best_probability",    c_float),
+        ("x",                   c_int32),
+        ("y",                   c_int32),
+        ("width",               c_int32),
+        ("height",              c_int32),
+        ("center_x",            c_float),
+        ("center_y",            c_float),
+        ("normalized_width",    c_float),
+        ("normalized_height",   c_float),
+        ("tile",                c_int32),
+        ("object_id",           c_uint64)]
+
+"""
+Fill in a caller-provided array of @ref DarkHelpPredictionResult with the
+prediction results.  Returns the total number of predictions.  For example:
+
+    count = DarkHelp.PredictFN(dh, "image.jpg".encode("utf-8"))
+    results = (DarkHelp.DarkHelpPredictionResult * count)()
+    DarkHelp.GetPredictionResultsArray(dh, results, count)
+
+The array can also be viewed as a numpy structured array without any copy,
+using numpy.ctypeslib.as_array(results).
+@see @ref GetPredictionResultsArray()
+"""
+GetPredictionResultsArray = lib.GetPredictionResultsArray
+GetPredictionResultsArray.argtypes = [c_void_p, POINTER(DarkHelpPredictionResult), c_int]
+GetPredictionResultsArray.restype = c_int
+
 """
 Calls DarkHelp's @p annotate() with the last image to be processed by
 DarkHelp's @p predict().
@@ -295,3 +373,10 @@ SetSnappingLimitGrow.restype = c_float
 EnableUseFastImageResize = lib.EnableUseFastImageResize
 EnableUseFastImageResize.argtypes = [c_void_p, c_bool]
 EnableUseFastImageResize.restype = c_bool
+
+"""
+@see @ref DarkHelp::Config::use_letterbox
+"""
+EnableLetterbox = lib.EnableLetterbox
+EnableLetterbox.argtypes = [c_void_p, c_bool]
+EnableLetterbox.restype = c_bool
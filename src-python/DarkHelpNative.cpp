@@ -0,0 +1,652 @@
+/* DarkHelp - C++ helper class for Darknet's C API.
+ * Copyright 2019-2024 Stephane Charette <stephanecharette@gmail.com>
+ * MIT license applies.  See "license.txt" for details.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include "DarkHelp.hpp"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+
+/** @file
+ * Native CPython module for %DarkHelp.  Unlike the @p ctypes wrapper in @p DarkHelp.py, this module accepts any object
+ * which implements the buffer protocol (such as @p numpy arrays) without copying the image, releases the GIL while the
+ * neural network is running, and returns the results as a structured @p numpy array instead of a JSON string.  This
+ * means a Python thread pool with one @p darkhelp_native.NN object per thread can use multiple cores.
+ */
+
+
+namespace
+{
+	/// The Python object which wraps a @ref DarkHelp::NN.
+	struct PyNN
+	{
+		PyObject_HEAD
+
+		DarkHelp::NN * nn;
+
+		/** Serializes access to @p nn, including the getters and setters.  The GIL must never be held while waiting for
+		 * this, since @p predict() holds it for the entire inference.  @see @ref lock_nn()
+		 */
+		std::mutex * lock;
+
+		/** Incremented by each call to @p predict() while @p lock is held.  Used to decide which image buffer to keep
+		 * when several threads call @p predict() on the same object.
+		 */
+		std::atomic<size_t> * predictions_started;
+
+		/** The image used by the last call to @p predict().  @ref DarkHelp::NN::original_image points directly into
+		 * this buffer, so it must not be released until the next call to @p predict() or until the object is destroyed.
+		 */
+		Py_buffer view;
+		bool has_view;
+	};
+
+
+	/// The @p dtype used for prediction results.  Same layout as @ref DarkHelpPredictionResult.
+	PyArray_Descr * result_dtype = nullptr;
+
+
+	PyArray_Descr * create_result_dtype()
+	{
+		PyObject * fields = Py_BuildValue("[(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)]",
+			"best_class"		, "<i4",
+			"best_probability"	, "<f4",
+			"x"					, "<i4",
+			"y"					, "<i4",
+			"width"				, "<i4",
+			"height"			, "<i4",
+			"center_x"			, "<f4",
+			"center_y"			, "<f4",
+			"normalized_width"	, "<f4",
+			"normalized_height"	, "<f4",
+			"tile"				, "<i4",
+			"object_id"			, "<u8");
+
+		PyArray_Descr * descr = nullptr;
+		if (fields)
+		{
+			PyArray_DescrConverter(fields, &descr);
+			Py_DECREF(fields);
+		}
+
+		// use the Python attribute since the layout of PyArray_Descr changed between numpy v1 and v2
+		PyObject * itemsize = (descr ? PyObject_GetAttrString(reinterpret_cast<PyObject*>(descr), "itemsize") : nullptr);
+		const size_t size = (itemsize ? PyLong_AsSize_t(itemsize) : 0);
+		Py_XDECREF(itemsize);
+
+		if (descr and size != sizeof(DarkHelpPredictionResult))
+		{
+			Py_DECREF(descr);
+			descr = nullptr;
+			PyErr_SetString(PyExc_RuntimeError, "prediction result dtype does not match DarkHelpPredictionResult");
+		}
+
+		return descr;
+	}
+
+
+	void release_view(PyNN * self)
+	{
+		if (self->has_view)
+		{
+			PyBuffer_Release(&self->view);
+			self->has_view = false;
+		}
+
+		return;
+	}
+
+
+	void PyNN_dealloc(PyNN * self)
+	{
+		delete self->nn;
+		delete self->lock;
+		delete self->predictions_started;
+		self->nn					= nullptr;
+		self->lock					= nullptr;
+		self->predictions_started	= nullptr;
+		release_view(self);
+
+		PyTypeObject * type = Py_TYPE(self);
+		type->tp_free(reinterpret_cast<PyObject*>(self));
+		Py_DECREF(type);
+
+		return;
+	}
+
+
+	int PyNN_init(PyNN * self, PyObject * args, PyObject * kwargs)
+	{
+		static const char * keywords[] = {"fn1", "fn2", "fn3", nullptr};
+		const char * fn1 = nullptr;
+		const char * fn2 = nullptr;
+		const char * fn3 = nullptr;
+
+		if (not PyArg_ParseTupleAndKeywords(args, kwargs, "sss", const_cast<char**>(keywords), &fn1, &fn2, &fn3))
+		{
+			return -1;
+		}
+
+		if (self->nn)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "neural network has already been initialized");
+			return -1;
+		}
+
+		std::string error;
+		DarkHelp::NN * nn = nullptr;
+
+		// loading the weights can take several seconds, so let other Python threads run in the meantime
+		Py_BEGIN_ALLOW_THREADS
+		try
+		{
+			nn = new DarkHelp::NN(fn1, fn2, fn3);
+		}
+		catch (const std::exception & e)
+		{
+			error = e.what();
+		}
+		Py_END_ALLOW_THREADS
+
+		if (nn == nullptr)
+		{
+			PyErr_SetString(PyExc_RuntimeError, error.c_str());
+			return -1;
+		}
+
+		self->nn					= nn;
+		self->lock					= new std::mutex;
+		self->predictions_started	= new std::atomic<size_t>(0);
+
+		return 0;
+	}
+
+
+	/** Lock @ref PyNN::lock from a thread which holds the GIL.  If another thread is running inference, the GIL is released
+	 * while waiting so the rest of the Python threads can keep running.
+	 */
+	std::unique_lock<std::mutex> lock_nn(PyNN * self)
+	{
+		std::unique_lock<std::mutex> lock(*self->lock, std::try_to_lock);
+		if (not lock.owns_lock())
+		{
+			Py_BEGIN_ALLOW_THREADS
+			lock.lock();
+			Py_END_ALLOW_THREADS
+		}
+
+		return lock;
+	}
+
+
+	bool is_initialized(PyNN * self)
+	{
+		if (self->nn == nullptr)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "neural network has not been initialized");
+			return false;
+		}
+
+		return true;
+	}
+
+
+	/** Wrap the buffer in a @p cv::Mat without copying the pixels.  The buffer must be @p uint8 with a shape of either
+	 * @p (height,width) or @p (height,width,channels).  Rows may be padded, but the pixels within a row must be packed.
+	 */
+	bool buffer_to_mat(const Py_buffer & view, cv::Mat & mat)
+	{
+		if (view.format and std::strcmp(view.format, "B") != 0)
+		{
+			PyErr_Format(PyExc_TypeError, "image must be uint8, not format \"%s\"", view.format);
+			return false;
+		}
+
+		if (view.ndim != 2 and view.ndim != 3)
+		{
+			PyErr_Format(PyExc_ValueError, "image must have 2 or 3 dimensions, not %d", view.ndim);
+			return false;
+		}
+
+		const int rows		= static_cast<int>(view.shape[0]);
+		const int cols		= static_cast<int>(view.shape[1]);
+		const int channels	= (view.ndim == 3 ? static_cast<int>(view.shape[2]) : 1);
+
+		if (rows <= 0 or cols <= 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "image is empty");
+			return false;
+		}
+
+		if (channels != 1 and channels != 3 and channels != 4)
+		{
+			PyErr_Format(PyExc_ValueError, "image must have 1, 3, or 4 channels, not %d", channels);
+			return false;
+		}
+
+		if (view.strides[1] != channels or (view.ndim == 3 and view.strides[2] != 1) or view.strides[0] < cols * channels)
+		{
+			PyErr_SetString(PyExc_ValueError, "pixels within each row must be contiguous (use numpy.ascontiguousarray)");
+			return false;
+		}
+
+		mat = cv::Mat(rows, cols, CV_8UC(channels), view.buf, static_cast<size_t>(view.strides[0]));
+
+		return true;
+	}
+
+
+	PyObject * create_results_array(const DarkHelp::PredictionResults & predictions)
+	{
+		npy_intp dims[1] = {static_cast<npy_intp>(predictions.size())};
+
+		// PyArray_NewFromDescr() steals a reference
+		Py_INCREF(result_dtype);
+		PyObject * array = PyArray_NewFromDescr(&PyArray_Type, result_dtype, 1, dims, nullptr, nullptr, 0, nullptr);
+		if (array == nullptr)
+		{
+			return nullptr;
+		}
+
+		auto results = reinterpret_cast<DarkHelpPredictionResult*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array)));
+		for (size_t idx = 0; idx < predictions.size(); idx ++)
+		{
+			const auto & pred	= predictions[idx];
+			auto & r			= results[idx];
+
+			r.best_class		= pred.best_class;
+			r.best_probability	= pred.best_probability;
+			r.x					= pred.rect.x;
+			r.y					= pred.rect.y;
+			r.width				= pred.rect.width;
+			r.height			= pred.rect.height;
+			r.center_x			= pred.original_point.x;
+			r.center_y			= pred.original_point.y;
+			r.normalized_width	= pred.original_size.width;
+			r.normalized_height	= pred.original_size.height;
+			r.tile				= pred.tile;
+			r.object_id			= pred.object_id;
+		}
+
+		return array;
+	}
+
+
+	PyObject * PyNN_predict(PyNN * self, PyObject * args, PyObject * kwargs)
+	{
+		static const char * keywords[] = {"image", "threshold", nullptr};
+		PyObject * image = nullptr;
+		float threshold = -1.0f;
+
+		if (not PyArg_ParseTupleAndKeywords(args, kwargs, "O|f", const_cast<char**>(keywords), &image, &threshold))
+		{
+			return nullptr;
+		}
+
+		if (not is_initialized(self))
+		{
+			return nullptr;
+		}
+
+		Py_buffer view;
+		if (PyObject_GetBuffer(image, &view, PyBUF_STRIDES | PyBUF_FORMAT) != 0)
+		{
+			return nullptr;
+		}
+
+		cv::Mat mat;
+		if (not buffer_to_mat(view, mat))
+		{
+			PyBuffer_Release(&view);
+			return nullptr;
+		}
+
+		std::string error;
+		DarkHelp::PredictionResults predictions;
+		size_t sequence = 0;
+
+		Py_BEGIN_ALLOW_THREADS
+		try
+		{
+			std::scoped_lock lock(*self->lock);
+			sequence = ++ (*self->predictions_started);
+
+			if (mat.channels() == 4)
+			{
+				cv::Mat bgr;
+				cv::cvtColor(mat, bgr, cv::COLOR_BGRA2BGR);
+				mat = bgr;
+			}
+			else if (mat.channels() == 1 and self->nn->image_channels() != 1)
+			{
+				cv::Mat bgr;
+				cv::cvtColor(mat, bgr, cv::COLOR_GRAY2BGR);
+				mat = bgr;
+			}
+
+			predictions = self->nn->predict(mat, threshold);
+		}
+		catch (const std::exception & e)
+		{
+			error = e.what();
+		}
+		Py_END_ALLOW_THREADS
+
+		if (sequence == *self->predictions_started)
+		{
+			// keep this buffer alive since the NN may still reference it when annotate() is called
+			release_view(self);
+			self->view		= view;
+			self->has_view	= true;
+		}
+		else
+		{
+			// another thread has called predict() since, so the NN no longer references this buffer
+			PyBuffer_Release(&view);
+		}
+
+		if (not error.empty())
+		{
+			PyErr_SetString(PyExc_RuntimeError, error.c_str());
+			return nullptr;
+		}
+
+		return create_results_array(predictions);
+	}
+
+
+	PyObject * PyNN_annotate(PyNN * self, PyObject * args, PyObject * kwargs)
+	{
+		static const char * keywords[] = {"threshold", nullptr};
+		float threshold = -1.0f;
+
+		if (not PyArg_ParseTupleAndKeywords(args, kwargs, "|f", const_cast<char**>(keywords), &threshold))
+		{
+			return nullptr;
+		}
+
+		if (not is_initialized(self))
+		{
+			return nullptr;
+		}
+
+		std::string error;
+		cv::Mat mat;
+
+		Py_BEGIN_ALLOW_THREADS
+		try
+		{
+			std::scoped_lock lock(*self->lock);
+			mat = self->nn->annotate(threshold);
+		}
+		catch (const std::exception & e)
+		{
+			error = e.what();
+		}
+		Py_END_ALLOW_THREADS
+
+		if (not error.empty())
+		{
+			PyErr_SetString(PyExc_RuntimeError, error.c_str());
+			return nullptr;
+		}
+
+		if (mat.empty())
+		{
+			Py_RETURN_NONE;
+		}
+
+		npy_intp dims[3] = {mat.rows, mat.cols, mat.channels()};
+		PyObject * array = PyArray_SimpleNew(mat.channels() == 1 ? 2 : 3, dims, NPY_UINT8);
+		if (array == nullptr)
+		{
+			return nullptr;
+		}
+
+		const size_t row_size = mat.cols * mat.elemSize();
+		uint8_t * dst = reinterpret_cast<uint8_t*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array)));
+		for (int y = 0; y < mat.rows; y ++)
+		{
+			std::memcpy(dst + y * row_size, mat.ptr<uint8_t>(y), row_size);
+		}
+
+		return array;
+	}
+
+
+	PyObject * PyNN_get_names(PyNN * self, void *)
+	{
+		if (not is_initialized(self))
+		{
+			return nullptr;
+		}
+
+		DarkHelp::VStr names;
+		if (true)
+		{
+			auto lock = lock_nn(self);
+			names = self->nn->names;
+		}
+
+		PyObject * list = PyList_New(names.size());
+		for (size_t idx = 0; list and idx < names.size(); idx ++)
+		{
+			PyList_SET_ITEM(list, idx, PyUnicode_FromString(names[idx].c_str()));
+		}
+
+		return list;
+	}
+
+
+	PyObject * PyNN_get_duration(PyNN * self, void *)
+	{
+		if (not is_initialized(self))
+		{
+			return nullptr;
+		}
+
+		auto lock = lock_nn(self);
+		const double seconds = std::chrono::duration<double>(self->nn->duration).count();
+
+		return PyFloat_FromDouble(seconds);
+	}
+
+
+	PyObject * PyNN_get_threshold(PyNN * self, void *)
+	{
+		if (not is_initialized(self))
+		{
+			return nullptr;
+		}
+
+		auto lock = lock_nn(self);
+
+		return PyFloat_FromDouble(self->nn->config.threshold);
+	}
+
+
+	int PyNN_set_threshold(PyNN * self, PyObject * value, void *)
+	{
+		if (not is_initialized(self))
+		{
+			return -1;
+		}
+
+		const double threshold = PyFloat_AsDouble(value);
+		if (PyErr_Occurred())
+		{
+			return -1;
+		}
+
+		auto lock = lock_nn(self);
+		self->nn->config.threshold = static_cast<float>(threshold);
+
+		return 0;
+	}
+
+
+	PyObject * PyNN_get_enable_tiles(PyNN * self, void *)
+	{
+		if (not is_initialized(self))
+		{
+			return nullptr;
+		}
+
+		auto lock = lock_nn(self);
+
+		return PyBool_FromLong(self->nn->config.enable_tiles);
+	}
+
+
+	int PyNN_set_enable_tiles(PyNN * self, PyObject * value, void *)
+	{
+		if (not is_initialized(self))
+		{
+			return -1;
+		}
+
+		const int enabled = PyObject_IsTrue(value);
+		if (enabled < 0)
+		{
+			return -1;
+		}
+
+		auto lock = lock_nn(self);
+		self->nn->config.enable_tiles = enabled;
+
+		return 0;
+	}
+
+
+	PyObject * PyNN_get_snapping(PyNN * self, void *)
+	{
+		if (not is_initialized(self))
+		{
+			return nullptr;
+		}
+
+		auto lock = lock_nn(self);
+
+		return PyBool_FromLong(self->nn->config.snapping_enabled);
+	}
+
+
+	int PyNN_set_snapping(PyNN * self, PyObject * value, void *)
+	{
+		if (not is_initialized(self))
+		{
+			return -1;
+		}
+
+		const int enabled = PyObject_IsTrue(value);
+		if (enabled < 0)
+		{
+			return -1;
+		}
+
+		auto lock = lock_nn(self);
+		self->nn->config.snapping_enabled = enabled;
+
+		return 0;
+	}
+
+
+	PyMethodDef PyNN_methods[] =
+	{
+		{"predict"	, reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(PyNN_predict))	, METH_VARARGS | METH_KEYWORDS,
+			"predict(image, threshold=-1.0)\n--\n\n"
+			"Run inference on a uint8 BGR, BGRA, or greyscale image such as a numpy array.  The image is not copied,\n"
+			"and the GIL is released while the neural network is running.  Returns a structured numpy array."},
+		{"annotate"	, reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(PyNN_annotate))	, METH_VARARGS | METH_KEYWORDS,
+			"annotate(threshold=-1.0)\n--\n\n"
+			"Return a copy of the last image with the predictions drawn on it, or None if predict() was not called."},
+		{nullptr, nullptr, 0, nullptr}
+	};
+
+
+	PyGetSetDef PyNN_getset[] =
+	{
+		{"names"		, reinterpret_cast<getter>(reinterpret_cast<void(*)()>(PyNN_get_names))			, nullptr																	, "The list of class names."							, nullptr},
+		{"duration"		, reinterpret_cast<getter>(reinterpret_cast<void(*)()>(PyNN_get_duration))		, nullptr																	, "Time in seconds taken by the last prediction."		, nullptr},
+		{"threshold"	, reinterpret_cast<getter>(reinterpret_cast<void(*)()>(PyNN_get_threshold))		, reinterpret_cast<setter>(reinterpret_cast<void(*)()>(PyNN_set_threshold))		, "Detection threshold, between 0.0 and 1.0."			, nullptr},
+		{"enable_tiles"	, reinterpret_cast<getter>(reinterpret_cast<void(*)()>(PyNN_get_enable_tiles))	, reinterpret_cast<setter>(reinterpret_cast<void(*)()>(PyNN_set_enable_tiles))	, "Whether large images are broken into tiles."		, nullptr},
+		{"snapping"		, reinterpret_cast<getter>(reinterpret_cast<void(*)()>(PyNN_get_snapping))		, reinterpret_cast<setter>(reinterpret_cast<void(*)()>(PyNN_set_snapping))		, "Whether annotations are snapped to the objects."	, nullptr},
+		{nullptr, nullptr, nullptr, nullptr, nullptr}
+	};
+
+
+	PyType_Slot PyNN_slots[] =
+	{
+		{Py_tp_doc		, const_cast<char*>("NN(fn1, fn2, fn3)\n--\n\nLoad a neural network.  The .cfg, .names, and .weights filenames may be given in any order.")},
+		{Py_tp_new		, reinterpret_cast<void*>(PyType_GenericNew)},
+		{Py_tp_init		, reinterpret_cast<void*>(PyNN_init)},
+		{Py_tp_dealloc	, reinterpret_cast<void*>(PyNN_dealloc)},
+		{Py_tp_methods	, PyNN_methods},
+		{Py_tp_getset	, PyNN_getset},
+		{0, nullptr}
+	};
+
+
+	PyType_Spec PyNN_spec =
+	{
+		"darkhelp_native.NN",
+		sizeof(PyNN),
+		0,
+		Py_TPFLAGS_DEFAULT,
+		PyNN_slots
+	};
+
+
+	PyModuleDef darkhelp_native_module =
+	{
+		PyModuleDef_HEAD_INIT,
+		"darkhelp_native",
+		"Native bindings for DarkHelp.  Images are passed without copies and the GIL is released during inference.",
+		-1,
+		nullptr,
+		nullptr,
+		nullptr,
+		nullptr,
+		nullptr
+	};
+}
+
+
+PyMODINIT_FUNC PyInit_darkhelp_native()
+{
+	import_array();
+
+	result_dtype = create_result_dtype();
+	if (result_dtype == nullptr)
+	{
+		return nullptr;
+	}
+
+	PyObject * module = PyModule_Create(&darkhelp_native_module);
+	if (module == nullptr)
+	{
+		return nullptr;
+	}
+
+	PyObject * type = PyType_FromSpec(&PyNN_spec);
+	if (type == nullptr or PyModule_AddObject(module, "NN", type) < 0)
+	{
+		Py_XDECREF(type);
+		Py_DECREF(module);
+		return nullptr;
+	}
+
+	Py_INCREF(result_dtype);
+	PyModule_AddObject(module, "result_dtype", reinterpret_cast<PyObject*>(result_dtype));
+	PyModule_AddStringConstant(module, "__version__", DarkHelp::version().c_str());
+
+	return module;
+}
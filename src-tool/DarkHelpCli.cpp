@@ -8,7 +8,10 @@
 #include <chrono>
 #include <fstream>
 #include <atomic>
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <deque>
 #include <string>
@@ -158,7 +161,11 @@ struct Options
 	bool			keep_annotated_images;
 	bool			use_json_output;
 	nlohmann::json	json;
+	DarkHelp::ModelCache::SPModel model;	// The .cfg, .names, and .weights used to load worker_networks.  Released once they are all loaded.
 	DarkHelp::NN	nn;
+	std::vector<std::unique_ptr<DarkHelp::NN>> worker_networks; // Additional copies of the network used by --threads.  See get_network().
+	size_t			worker_networks_loaded;
+	std::mutex		worker_networks_lock;
 	bool			force_greyscale;
 	bool			done;
 	bool			size1_is_set;
@@ -172,6 +179,7 @@ struct Options
 	size_t			file_index;
 	std::string		message_text;	// Message that needs to be shown to the user.  This text will be printed overtop of the image.
 	std::time_t		message_time;	// Time at which the message should be cleared.
+	size_t			threads;		// Number of copies of the neural network to run in parallel.  See --threads.
 
 	Options() :
 		magic_cookie			(0),
@@ -184,7 +192,9 @@ struct Options
 		in_slideshow			(false),
 		wait_time_in_milliseconds_for_slideshow(500),
 		file_index				(0),
-		message_time			(0)
+		message_time			(0),
+		worker_networks_loaded	(0),
+		threads					(1)
 	{
 		return;
 	}
@@ -527,10 +537,12 @@ void init(Options & options, int argc, char *argv[])
 	TCLAP::ValueArg<std::string> use_tiles			("T", "tiles"		, "Determines if large images are processed by breaking into tiles. Default is \"false\"."					, false, "false"	, &allowed_booleans		, cli);
 	TCLAP::ValueArg<std::string> hierarchy			("y", "hierarchy"	, "The hierarchy threshold to use when predicting. Default is 0.5."											, false, "0.5"		, &float_constraint		, cli);
 	TCLAP::ValueArg<std::string> image_type			("Y", "type"		, "The image type to use when --keep has also been enabled. Can be \"png\" or \"jpg\". Default is \"png\"."	, false, "png"		, &image_type_constraint, cli);
+	TCLAP::ValueArg<std::string> letterbox			("", "letterbox"	, "Letterbox the images to keep the aspect ratio when resizing to the network dimensions. Default is false."	, false, "false"	, &allowed_booleans		, cli);
 	TCLAP::ValueArg<std::string> out_dir			("", "outdir"		, "Output directory to use when --keep has also been enabled. Default is /tmp/."							, false, ""			, &dir_exist_constraint	, cli);
 	TCLAP::ValueArg<std::string> pixelate			("", "pixelate"		, "Determines if predictions are pixelated in the output annotation image. Default is false."				, false, "false"	, &allowed_booleans		, cli);
 	TCLAP::ValueArg<std::string> redirection		("", "redirection"	, "Determines if STDOUT and STDERR redirection will be performed when Darknet loads. Default is false."		, false, "false"	, &allowed_booleans		, cli);
 	TCLAP::SwitchArg suppress						("", "suppress"		, "Suppress all labels (bounding boxes are shown, but not the labels at the top of each bounding box)."													, cli, false );
+	TCLAP::ValueArg<std::string> threads			("", "threads"		, "Number of threads running the neural network on images (with --json) and video frames. Default is 1."		, false, "1"		, &int_constraint		, cli);
 	TCLAP::ValueArg<std::string> tile_edge			("", "tile-edge"	, "How close objects must be to tile edges to be re-combined. Range is 0.01-1.0+. Default is 0.25."			, false, "0.25"		, &float_constraint		, cli);
 	TCLAP::ValueArg<std::string> tile_rect			("", "tile-rect"	, "How similarly objects must line up across tiles to be re-combined. Range is 1.0-2.0+. Default is 1.20."	, false, "1.2"		, &float_constraint		, cli);
 	TCLAP::UnlabeledValueArg<std::string> cfg		("config"			, "The darknet config filename, usually ends in \".cfg\"."													, true	, ""		, &file_exist_constraint, cli);
@@ -625,9 +637,28 @@ void init(Options & options, int argc, char *argv[])
 			"UNKNOWN")
 		<< std::endl;
 
+	const int number_of_threads = std::stoi(threads.getValue());
+	if (number_of_threads < 1 or number_of_threads > 32)
+	{
+		// same limit as DarkHelp::DHThreads and DarkHelp Server, each thread needs its own copy of the neural network
+		throw std::invalid_argument("the number of threads must be between 1 and 32, not " + threads.getValue());
+	}
+	options.threads = number_of_threads;
+	options.worker_networks.resize(options.threads - 1);
+
 	// we already verified the files several lines up, so no need to do it again
 	options.nn.config.redirect_darknet_output = get_bool(redirection);
-	options.nn.init(options.cfg_fn, options.weights_fn, options.names_fn, false, darkhelp_driver);
+	if (options.threads == 1)
+	{
+		// only one copy of the network, so there is no reason to keep the files in memory
+		options.nn.init(options.cfg_fn, options.weights_fn, options.names_fn, false, darkhelp_driver);
+	}
+	else
+	{
+		// the files are read only once, and the additional copies of the network are loaded from this same model
+		options.model = DarkHelp::ModelCache::load(options.cfg_fn, options.weights_fn, options.names_fn);
+		options.nn.init_from_memory(options.model->cfg, options.model->names, options.model->weights, darkhelp_driver);
+	}
 
 	if (options.neural_network_name.empty())
 	{
@@ -684,6 +715,7 @@ void init(Options & options, int argc, char *argv[])
 	options.nn.config.snapping_vertical_tolerance		= std::stoi(snap_vertical_tolerance.getValue());
 	options.nn.config.annotation_pixelate_enabled		= get_bool(pixelate);
 	options.nn.config.redirect_darknet_output			= get_bool(redirection);
+	options.nn.config.use_letterbox						= get_bool(letterbox);
 
 	if (suppress.isSet())
 	{
@@ -702,7 +734,9 @@ void init(Options & options, int argc, char *argv[])
 	options.json["settings"]["keep_annotations"]		= options.keep_annotated_images;
 	options.json["settings"]["enable_tiles"]			= options.nn.config.enable_tiles;
 	options.json["settings"]["snapping"]				= options.nn.config.snapping_enabled;
+	options.json["settings"]["letterbox"]				= options.nn.config.use_letterbox;
 	options.json["settings"]["output_redirection"]		= options.nn.config.redirect_darknet_output;
+	options.json["settings"]["threads"]					= options.threads;
 
 	if (resize1.isSet())
 	{
@@ -834,6 +868,288 @@ void init(Options & options, int argc, char *argv[])
 }
 
 
+/* Queue with a maximum size, used to pass video frames between the threads in VideoPipeline.  Once close() has been
+ * called, push() fails immediately, and pop() only returns the items that were already in the queue.
+ */
+template <typename T>
+class BoundedQueue final
+{
+	public:
+
+		BoundedQueue(const size_t max_size) :
+			capacity(max_size),
+			closed(false)
+		{
+			return;
+		}
+
+		/// Blocks while the queue is full.  Returns @p false if the queue has been closed.
+		bool push(T item)
+		{
+			std::unique_lock lock(mutex);
+			not_full.wait(lock, [&]{ return closed or items.size() < capacity; });
+			if (closed)
+			{
+				return false;
+			}
+			items.push_back(std::move(item));
+			not_empty.notify_one();
+
+			return true;
+		}
+
+		/// Blocks while the queue is empty.  Returns @p false once the queue has been closed and is empty.
+		bool pop(T & item)
+		{
+			std::unique_lock lock(mutex);
+			not_empty.wait(lock, [&]{ return closed or not items.empty(); });
+			if (items.empty())
+			{
+				return false;
+			}
+			item = std::move(items.front());
+			items.pop_front();
+			not_full.notify_one();
+
+			return true;
+		}
+
+		void close()
+		{
+			std::scoped_lock lock(mutex);
+			closed = true;
+			not_full.notify_all();
+			not_empty.notify_all();
+
+			return;
+		}
+
+	private:
+
+		const size_t capacity;
+		bool closed;
+		std::deque<T> items;
+		std::mutex mutex;
+		std::condition_variable not_full;
+		std::condition_variable not_empty;
+};
+
+
+struct VideoFrame
+{
+	cv::Mat									mat;
+	DarkHelp::PredictionResults				results;
+	std::chrono::high_resolution_clock::duration	duration;
+};
+
+
+// Convert and resize a frame exactly like we do for static images.
+void prepare_frame(const Options & options, cv::Mat & frame)
+{
+	if (options.force_greyscale)
+	{
+		// libdarknet.so segfaults when given single-channel images, so convert it back to a 3-channel image
+		cv::Mat tmp;
+		cv::cvtColor(frame, tmp, cv::COLOR_BGR2GRAY);
+		cv::cvtColor(tmp, frame, cv::COLOR_GRAY2BGR);
+	}
+
+	if (options.size1_is_set)
+	{
+		frame = DarkHelp::resize_keeping_aspect_ratio(frame, options.size1);
+	}
+
+	return;
+}
+
+
+/* Get the neural network used by the worker thread #id.  Worker #0 uses options.nn, while the others use a copy which is
+ * loaded from options.model the first time it is needed.  These copies are kept until the CLI exits, so they are loaded
+ * at most once regardless of how many images and videos are processed.  Each thread must only ask for its own network.
+ * Once all the copies have been loaded, options.model is released since it is no longer needed.
+ */
+DarkHelp::NN & get_network(Options & options, const size_t id, const DarkHelp::Config & config)
+{
+	if (id == 0)
+	{
+		return options.nn;
+	}
+
+	auto & network = options.worker_networks.at(id - 1);
+	if (not network)
+	{
+		DarkHelp::ModelCache::SPModel model;
+		if (true)
+		{
+			std::scoped_lock lock(options.worker_networks_lock);
+			model = options.model;
+		}
+
+		// the network is loaded without holding the lock so all the copies can be loaded at the same time
+		auto nn = std::make_unique<DarkHelp::NN>();
+		nn->config = config;
+		nn->init_from_memory(model->cfg, model->names, model->weights, config.driver);
+		network = std::move(nn);
+
+		std::scoped_lock lock(options.worker_networks_lock);
+		options.worker_networks_loaded ++;
+		if (options.worker_networks_loaded == options.worker_networks.size())
+		{
+			options.model.reset();
+		}
+	}
+
+	// use the same settings as the first worker in case they were changed since the network was loaded
+	network->config = config;
+
+	return *network;
+}
+
+
+/* Runs the video decoder and the neural networks on secondary threads, so decoding, inference, and annotating+encoding
+ * (which remains on the main thread since it may need to show the frames) all happen at the same time.  Frames are
+ * handed out to the inference threads round-robin, with one input and one output queue per thread, so reading the
+ * output queues in the same round-robin order returns the frames in the original order.
+ *
+ * The first inference thread uses options.nn, the others use the copies of the network from get_network().
+ */
+class VideoPipeline final
+{
+	public:
+
+		VideoPipeline(Options & o, cv::VideoCapture & video) :
+			options(o),
+			input_video(video),
+			config(o.nn.config),
+			number_of_workers(std::max(o.threads, size_t(1))),
+			next_frame(0)
+		{
+			// each queue is kept short, there is no point in decoding far ahead of the neural networks
+			for (size_t id = 0; id < number_of_workers; id ++)
+			{
+				input_queues	.emplace_back(new BoundedQueue<VideoFrame>(2));
+				output_queues	.emplace_back(new BoundedQueue<VideoFrame>(2));
+			}
+
+			annotator.config	= config;
+			annotator.names		= options.nn.names;
+
+			for (size_t id = 0; id < number_of_workers; id ++)
+			{
+				threads.emplace_back(&VideoPipeline::infer, this, id);
+			}
+			threads.emplace_back(&VideoPipeline::decode, this);
+
+			return;
+		}
+
+		~VideoPipeline()
+		{
+			for (size_t id = 0; id < number_of_workers; id ++)
+			{
+				input_queues[id]	->close();
+				output_queues[id]	->close();
+			}
+			for (auto & t : threads)
+			{
+				t.join();
+			}
+
+			return;
+		}
+
+		/// Get the next frame in order.  Returns @p false once all the frames have been processed.
+		bool next(VideoFrame & frame)
+		{
+			const size_t id = next_frame % number_of_workers;
+			if (not output_queues[id]->pop(frame))
+			{
+				return false;
+			}
+			next_frame ++;
+
+			return true;
+		}
+
+		/// Not used to run inference, only to annotate frames on the main thread.
+		DarkHelp::NN annotator;
+
+	private:
+
+		void decode()
+		{
+			size_t frame_index = 0;
+			while (not signal_raised)
+			{
+				VideoFrame frame;
+				input_video >> frame.mat;
+				if (frame.mat.empty())
+				{
+					break;
+				}
+
+				prepare_frame(options, frame.mat);
+
+				if (not input_queues[frame_index % number_of_workers]->push(std::move(frame)))
+				{
+					break;
+				}
+				frame_index ++;
+			}
+
+			// let the inference threads know there won't be any more frames
+			for (auto & queue : input_queues)
+			{
+				queue->close();
+			}
+
+			return;
+		}
+
+		void infer(const size_t id)
+		{
+			try
+			{
+				DarkHelp::NN & nn = get_network(options, id, config);
+
+				VideoFrame frame;
+				while (not signal_raised and input_queues[id]->pop(frame))
+				{
+					frame.results	= nn.predict(frame.mat);
+					frame.mat		= nn.original_image;
+					frame.duration	= nn.duration;
+
+					if (not output_queues[id]->push(std::move(frame)))
+					{
+						break;
+					}
+				}
+			}
+			catch (const std::exception & e)
+			{
+				std::cout << std::endl << "-> video thread #" << id << " caught exception: " << e.what() << std::endl;
+
+				// this thread can no longer process frames, which means the whole pipeline stops here
+				input_queues[id]->close();
+			}
+
+			// once the main thread has read everything in this queue, it knows the video is done
+			output_queues[id]->close();
+
+			return;
+		}
+
+		Options & options;
+		cv::VideoCapture & input_video;
+		const DarkHelp::Config config;
+		const size_t number_of_workers;
+		size_t next_frame;
+		std::vector<std::unique_ptr<BoundedQueue<VideoFrame>>> input_queues;
+		std::vector<std::unique_ptr<BoundedQueue<VideoFrame>>> output_queues;
+		std::vector<std::thread> threads;
+};
+
+
 void process_video(Options & options)
 {
 	cv::VideoCapture input_video;
@@ -921,34 +1237,27 @@ void process_video(Options & options)
 	size_t number_of_frames = 0;
 	const size_t rounded_fps = std::round(input_fps);
 	const auto start_time = std::chrono::high_resolution_clock::now();
+
+	// from this point on, input_video and the networks in options belong to the pipeline threads until it is destroyed
+	auto pipeline = std::make_unique<VideoPipeline>(options, input_video);
+	DarkHelp::NN & annotator = pipeline->annotator;
+
 	while (signal_raised == false)
 	{
-		cv::Mat frame;
-		input_video >> frame;
-		if (frame.empty())
+		VideoFrame video_frame;
+		if (not pipeline->next(video_frame))
 		{
 			break;
 		}
 
-		if (options.force_greyscale)
-		{
-			// libdarknet.so segfaults when given single-channel images, so convert it back to a 3-channel image
-			cv::Mat tmp;
-			cv::cvtColor(frame, tmp, cv::COLOR_BGR2GRAY);
-			cv::cvtColor(tmp, frame, cv::COLOR_GRAY2BGR);
-		}
-
-		if (options.size1_is_set)
-		{
-			frame = DarkHelp::resize_keeping_aspect_ratio(frame, options.size1);
-		}
-
-		options.nn.predict(frame);
+		annotator.original_image		= video_frame.mat;
+		annotator.prediction_results	= video_frame.results;
+		annotator.duration				= video_frame.duration;
 
 		// no need to figure out the average duration if the display of the duration field is turned off in annotate()
-		if (options.nn.config.annotation_include_duration)
+		if (annotator.config.annotation_include_duration)
 		{
-			duration_deque.push_front(options.nn.duration);
+			duration_deque.push_front(annotator.duration);
 			if (duration_deque.size() > 3 * rounded_fps)
 			{
 				duration_deque.resize(3 * rounded_fps);
@@ -959,10 +1268,11 @@ void process_video(Options & options)
 				average += duration;
 			}
 			average /= duration_deque.size();
-			options.nn.duration = average;
+			annotator.duration = average;
 		}
 
-		frame = options.nn.annotate();
+		// the decoded frame is not needed once it has been annotated, so draw directly on it instead of making a copy
+		cv::Mat frame = annotator.annotate_in_place(video_frame.mat);
 
 		if (options.size2_is_set)
 		{
@@ -1014,6 +1324,9 @@ void process_video(Options & options)
 	}
 	std::cout << std::endl;
 
+	// stop and join all the pipeline threads before options.nn is used again
+	pipeline.reset();
+
 	const auto milliseconds_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_time).count();
 
 	options.json["file"][options.file_index]["frames"				] = number_of_frames;
@@ -1029,7 +1342,25 @@ void process_video(Options & options)
 }
 
 
-void process_image(Options & options)
+std::string local_time_text(const std::time_t seconds)
+{
+	// std::localtime() is not thread-safe, and this is called from the worker threads when --threads is used
+	static std::mutex localtime_lock;
+	std::scoped_lock lock(localtime_lock);
+
+	const auto lt = std::localtime(&seconds);
+	char buffer[50];
+	std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S %z", lt);
+
+	return buffer;
+}
+
+
+/* Load and predict a single image, save the annotated image if necessary, and fill in the JSON for this file.  This is
+ * called both from the main thread with options.nn, and from the worker threads (with their own copy of the neural
+ * network) when --threads is used, so it must not modify "options".  Returns false if the image could not be read.
+ */
+bool predict_image(const Options & options, DarkHelp::NN & nn, const std::string & filename, nlohmann::json & json, cv::Mat & output_image, std::ostream & out)
 {
 	cv::Mat input_image;
 
@@ -1037,29 +1368,28 @@ void process_image(Options & options)
 	{
 		if (options.force_greyscale)
 		{
-			cv::Mat tmp = cv::imread(options.filename, cv::IMREAD_GRAYSCALE);
+			cv::Mat tmp = cv::imread(filename, cv::IMREAD_GRAYSCALE);
 			// libdarknet.so segfaults when given single-channel images, so convert it back to a 3-channel image
 			// forward_network() -> forward_convolutional_layer() -> im2col_cpu_ext()
 			cv::cvtColor(tmp, input_image, cv::COLOR_GRAY2BGR);
 		}
 		else
 		{
-			input_image = cv::imread(options.filename);
+			input_image = cv::imread(filename);
 		}
 	}
 	catch (...) {}
 
 	if (input_image.empty())
 	{
-		const auto msg = "Failed to read the image \"" + options.filename + "\".";
-		options.json["file"][options.file_index]["error"] = msg;
-		std::cout << msg << std::endl;
-		options.file_index ++;
-		return;
+		const auto msg = "Failed to read the image \"" + filename + "\".";
+		json["error"] = msg;
+		out << msg << std::endl;
+		return false;
 	}
 
-	options.json["file"][options.file_index]["original_width"	] = input_image.cols;
-	options.json["file"][options.file_index]["original_height"	] = input_image.rows;
+	json["original_width"	] = input_image.cols;
+	json["original_height"	] = input_image.rows;
 
 	if (options.size1_is_set)
 	{
@@ -1068,35 +1398,34 @@ void process_image(Options & options)
 		{
 			const auto msg = "resizing input image from " + std::to_string(input_image.cols) + "x" + std::to_string(input_image.rows) + " to " + std::to_string(options.size1.width) + "x" + std::to_string(options.size1.height);
 
-			options.json["file"][options.file_index]["msg"] = msg;
-			std::cout << "-> " << msg << std::endl;
+			json["msg"] = msg;
+			out << "-> " << msg << std::endl;
 			input_image = DarkHelp::resize_keeping_aspect_ratio(input_image, options.size1);
 		}
 	}
 
-	options.json["file"][options.file_index]["resized_width"	] = input_image.cols;
-	options.json["file"][options.file_index]["resized_height"	] = input_image.rows;
+	json["resized_width"	] = input_image.cols;
+	json["resized_height"	] = input_image.rows;
 
-	const auto results = options.nn.predict(input_image);
+	const auto results = nn.predict(input_image);
 
-	std::cout	<< "-> prediction took " << options.nn.duration_string();
-	if (options.nn.horizontal_tiles > 1 or options.nn.vertical_tiles > 1)
+	out	<< "-> prediction took " << nn.duration_string();
+	if (nn.horizontal_tiles > 1 or nn.vertical_tiles > 1)
 	{
-		std::cout	<< " across " << (options.nn.horizontal_tiles * options.nn.vertical_tiles) << " tiles "
-					<< "(" << options.nn.horizontal_tiles << "x" << options.nn.vertical_tiles << ")"
-					<< " each measuring " << options.nn.tile_size.width << "x" << options.nn.tile_size.height;
+		out	<< " across " << (nn.horizontal_tiles * nn.vertical_tiles) << " tiles "
+			<< "(" << nn.horizontal_tiles << "x" << nn.vertical_tiles << ")"
+			<< " each measuring " << nn.tile_size.width << "x" << nn.tile_size.height;
 	}
-	std::cout	<< std::endl
-				<< "-> " << results << std::endl;
+	out	<< std::endl
+		<< "-> " << results << std::endl;
 
-	cv::Mat output_image;
 	if (options.keep_annotated_images or options.use_json_output == false)
 	{
-		output_image = options.nn.annotate();
+		output_image = nn.annotate();
 
 		if (options.size2_is_set)
 		{
-			std::cout << "-> resizing output image from " << output_image.cols << "x" << output_image.rows << " to " << options.size2.width << "x" << options.size2.height << std::endl;
+			out << "-> resizing output image from " << output_image.cols << "x" << output_image.rows << " to " << options.size2.width << "x" << options.size2.height << std::endl;
 			output_image = DarkHelp::resize_keeping_aspect_ratio(output_image, options.size2);
 		}
 
@@ -1104,7 +1433,7 @@ void process_image(Options & options)
 		{
 			// save the annotated image to disk
 
-			std::string basename = options.filename;
+			std::string basename = filename;
 			size_t pos = basename.find_last_of("/\\");
 			if (pos != std::string::npos)
 			{
@@ -1128,8 +1457,8 @@ void process_image(Options & options)
 				output_filename /= (basename + ".jpg");
 				cv::imwrite(output_filename.string(), output_image, {cv::IMWRITE_JPEG_QUALITY, 75});
 			}
-			std::cout << "-> annotated image saved to \"" << output_filename.string() << "\"" << std::endl;
-			options.json["file"][options.file_index]["annotated_image"] = output_filename.string();
+			out << "-> annotated image saved to \"" << output_filename.string() << "\"" << std::endl;
+			json["annotated_image"] = output_filename.string();
 		}
 	}
 
@@ -1139,26 +1468,23 @@ void process_image(Options & options)
 		const auto epoch			= now.time_since_epoch();
 		const auto nanoseconds		= std::chrono::duration_cast<std::chrono::nanoseconds>	(epoch).count();
 		const std::time_t seconds	= std::chrono::duration_cast<std::chrono::seconds>		(epoch).count();
-		const auto lt				= std::localtime(&seconds);
-		char buffer[50];
-		std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S %z", lt);
 
-		options.json["file"][options.file_index]["timestamp"]["nanoseconds"	] = nanoseconds;
-		options.json["file"][options.file_index]["timestamp"]["epoch"		] = seconds;
-		options.json["file"][options.file_index]["timestamp"]["text"		] = buffer;
+		json["timestamp"]["nanoseconds"	] = nanoseconds;
+		json["timestamp"]["epoch"		] = seconds;
+		json["timestamp"]["text"		] = local_time_text(seconds);
 
-		options.json["file"][options.file_index]["count"				] = results.size();
-		options.json["file"][options.file_index]["duration"				] = options.nn.duration_string();
-		options.json["file"][options.file_index]["tiles"]["horizontal"	] = options.nn.horizontal_tiles;
-		options.json["file"][options.file_index]["tiles"]["vertical"	] = options.nn.vertical_tiles;
-		options.json["file"][options.file_index]["tiles"]["width"		] = options.nn.tile_size.width;
-		options.json["file"][options.file_index]["tiles"]["height"		] = options.nn.tile_size.height;
+		json["count"				] = results.size();
+		json["duration"				] = nn.duration_string();
+		json["tiles"]["horizontal"	] = nn.horizontal_tiles;
+		json["tiles"]["vertical"	] = nn.vertical_tiles;
+		json["tiles"]["width"		] = nn.tile_size.width;
+		json["tiles"]["height"		] = nn.tile_size.height;
 
 		for (size_t idx = 0; idx < results.size(); idx ++)
 		{
 			const auto & pred = results[idx];
 
-			auto & j = options.json["file"][options.file_index]["prediction"][idx];
+			auto & j = json["prediction"][idx];
 
 			j["prediction_index"]			= idx;
 			j["name"]						= pred.name;
@@ -1178,11 +1504,23 @@ void process_image(Options & options)
 			{
 				j["all_probabilities"][prop_count]["class"			] = prop.first;
 				j["all_probabilities"][prop_count]["probability"	] = prop.second;
-				j["all_probabilities"][prop_count]["name"			] = options.nn.names[prop.first];
+				j["all_probabilities"][prop_count]["name"			] = nn.names[prop.first];
 				prop_count ++;
 			}
 		}
+	}
+
+	return true;
+}
 
+
+void process_image(Options & options)
+{
+	cv::Mat output_image;
+
+	const bool success = predict_image(options, options.nn, options.filename, options.json["file"][options.file_index], output_image, std::cout);
+	if (not success or options.use_json_output)
+	{
 		// move to the next image
 		options.file_index ++;
 		return;
@@ -1376,6 +1714,139 @@ void process_image(Options & options)
 }
 
 
+/* Used with --json and --threads to process many images at once.  Each worker thread has its own copy of the neural
+ * network, and the results for each file are stored at the same index they would have had when processed one at a time
+ * so the JSON output does not depend on the number of threads.
+ */
+void process_in_parallel(Options & options)
+{
+	const size_t number_of_files = options.all_files.size();
+
+	// libmagic is not thread-safe, so sort out the images from the videos before starting the threads
+	std::vector<size_t> images;
+	std::vector<size_t> others;
+	for (size_t idx = 0; idx < number_of_files and not signal_raised; idx ++)
+	{
+		const auto & filename = options.all_files[idx];
+		const std::string mime_type = magic_file(options.magic_cookie, filename.c_str());
+
+		options.json["file"][idx]["filename"	] = filename;
+		options.json["file"][idx]["type"		] = mime_type;
+
+		if (mime_type.find("image/") == 0)
+		{
+			images.push_back(idx);
+		}
+		else
+		{
+			others.push_back(idx);
+		}
+	}
+
+	const size_t number_of_threads = std::min(options.threads, std::max(images.size(), size_t(1)));
+	std::cout << "-> processing " << images.size() << " image" << (images.size() == 1 ? "" : "s") << " using " << number_of_threads << " thread" << (number_of_threads == 1 ? "" : "s") << std::endl;
+
+	// take a copy of the configuration since options.nn is used by the first worker while the others are loading
+	const DarkHelp::Config config = options.nn.config;
+
+	std::vector<nlohmann::json> results(number_of_files);
+	std::atomic<size_t> next_image = 0;
+	std::mutex output_lock;
+
+	const auto worker = [&](const size_t id)
+	{
+		try
+		{
+			// the first worker re-uses the network which was loaded in init(), while the others use the copies which are
+			// kept in options and later re-used by the video pipeline
+			DarkHelp::NN & nn = get_network(options, id, config);
+
+			while (not signal_raised)
+			{
+				const size_t image_index = next_image ++;
+				if (image_index >= images.size())
+				{
+					break;
+				}
+
+				const size_t idx = images[image_index];
+				const auto & filename = options.all_files[idx];
+
+				// buffer the output for each image so the text from different threads is not mixed together
+				std::stringstream ss;
+				ss << "#" << (1 + idx) << "/" << number_of_files << ": loading \"" << filename << "\"" << std::endl;
+
+				try
+				{
+					cv::Mat output_image;
+					predict_image(options, nn, filename, results[idx], output_image, ss);
+				}
+				catch (const std::exception & e)
+				{
+					const auto msg = "Failed to process the image \"" + filename + "\": " + e.what();
+					results[idx]["error"] = msg;
+					ss << msg << std::endl;
+				}
+
+				std::scoped_lock lock(output_lock);
+				std::cout << ss.str() << std::flush;
+			}
+		}
+		catch (const std::exception & e)
+		{
+			std::scoped_lock lock(output_lock);
+			std::cout << "-> thread #" << id << " caught exception: " << e.what() << std::endl;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t id = 1; id < number_of_threads; id ++)
+	{
+		threads.emplace_back(worker, id);
+	}
+	worker(0);
+	for (auto & t : threads)
+	{
+		t.join();
+	}
+
+	for (const auto idx : images)
+	{
+		options.json["file"][idx].update(results[idx]);
+	}
+
+	// videos are still processed one at a time on the main thread
+	for (const auto idx : others)
+	{
+		if (signal_raised)
+		{
+			break;
+		}
+
+		options.file_index	= idx;
+		options.filename	= options.all_files[idx];
+		const auto mime_type = options.json["file"][idx]["type"].get<std::string>();
+
+		std::cout << "#" << (1 + idx) << "/" << number_of_files << ": loading \"" << options.filename << "\"" << std::endl;
+
+		if (mime_type.find("video/") == 0)
+		{
+			process_video(options);
+		}
+		else
+		{
+			const auto msg = "Unknown file type: \"" + options.filename + "\".";
+			options.json["file"][idx]["error"] = msg;
+			std::cout << msg << std::endl;
+		}
+	}
+
+	options.file_index = number_of_files;
+
+	return;
+}
+
+
 int main(int argc, char *argv[])
 {
 	try
@@ -1410,6 +1881,10 @@ int main(int argc, char *argv[])
 
 		set_msg(options, "press 'h' for help");
 		options.file_index = 0;
+		if (options.use_json_output and options.threads > 1)
+		{
+			process_in_parallel(options);
+		}
 		while (options.file_index < options.all_files.size() and not options.done and not signal_raised)
 		{
 			options.filename = options.all_files.at(options.file_index);
@@ -4,9 +4,20 @@
  */
 
 #include "DarkHelp.hpp"
+#include "DarkHelpFrameGrabber.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iomanip>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <thread>
 
 #include "json.hpp"
@@ -15,17 +26,55 @@
 #pragma warning(disable: 4244)
 #endif
 
-size_t total_number_of_images_processed	= 0;
+#ifndef WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+/* Without MSG_NOSIGNAL (macOS and some BSDs) writing to a socket which the client has already closed raises SIGPIPE
+ * and kills the server.  SO_NOSIGPIPE is set on every accepted socket where it exists, otherwise SIGPIPE is ignored.
+ */
+#define MSG_NOSIGNAL 0
+#ifndef SO_NOSIGPIPE
+#include <csignal>
+#define DARKHELP_IGNORE_SIGPIPE
+#endif
+#endif
+#endif
+
+#ifdef __linux__
+#include "DarkHelpSharedMemory.hpp"
+#include <climits>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+std::atomic<size_t> total_number_of_images_processed(0);
 bool crop_and_save_detected_objects		= false;
 bool save_annotated_image				= false;
 bool save_txt_annotations				= false;
 bool save_json_results					= false;
 bool apply_roi							= false;
-auto last_activity						= std::chrono::high_resolution_clock::now();
+std::atomic<std::chrono::high_resolution_clock::time_point> last_activity(std::chrono::high_resolution_clock::now());
 std::vector<cv::Rect> roi_rectangles;
 std::filesystem::path roi_fn;
 std::vector<std::string> messages;
 
+/* When inotify is available, this is the file descriptor used to watch the input directory.  A value of -1 means we're
+ * polling the input directory instead.
+ */
+int inotify_fd							= -1;
+bool inotify_rescan_needed				= true;
+std::deque<std::filesystem::path> inotify_pending_files;
+
 
 nlohmann::json create_darkhelp_defaults()
 {
@@ -77,6 +126,17 @@ nlohmann::json create_darkhelp_defaults()
 	j["darkhelp"]["server"]["settings"]["run_cmd_after_processing_images"			] = "";
 	j["darkhelp"]["server"]["settings"]["purge_files_after_cmd_completes"			] = true;
 	j["darkhelp"]["server"]["settings"]["use_camera_for_input"						] = false;
+	j["darkhelp"]["server"]["settings"]["use_inotify"								] = true;
+	j["darkhelp"]["server"]["settings"]["worker_threads"							] = 1;
+	j["darkhelp"]["server"]["settings"]["writer_threads"							] = 2;
+	j["darkhelp"]["server"]["settings"]["listen"]["unix_socket"						] = "";
+	j["darkhelp"]["server"]["settings"]["listen"]["tcp_port"						] = 0;
+	j["darkhelp"]["server"]["settings"]["listen"]["max_image_size_in_bytes"			] = 64 * 1024 * 1024;
+	j["darkhelp"]["server"]["settings"]["shared_memory"]["name"						] = "";
+	j["darkhelp"]["server"]["settings"]["shared_memory"]["slots"					] = 4;
+	j["darkhelp"]["server"]["settings"]["shared_memory"]["max_frame_size_in_bytes"	] = 3840 * 2160 * 3;
+	j["darkhelp"]["server"]["settings"]["shared_memory"]["max_result_size_in_bytes"	] = 1024 * 1024;
+	j["darkhelp"]["server"]["settings"]["shared_memory"]["frame_timeout_in_milliseconds"] = 2000;
 
 	j["darkhelp"]["server"]["settings"]["camera"]["save_original_image"				] = true;
 	j["darkhelp"]["server"]["settings"]["camera"]["name"							] = "/dev/video0";
@@ -84,6 +144,7 @@ nlohmann::json create_darkhelp_defaults()
 	j["darkhelp"]["server"]["settings"]["camera"]["height"							] = 480;
 	j["darkhelp"]["server"]["settings"]["camera"]["fps"								] = 30;
 	j["darkhelp"]["server"]["settings"]["camera"]["buffersize"						] = 2;
+	j["darkhelp"]["server"]["settings"]["camera"]["latest_frame_only"				] = true;
 
 	j["darkhelp"]["server"]["settings"]["apply_roi"									] = false;
 
@@ -91,7 +152,30 @@ nlohmann::json create_darkhelp_defaults()
 }
 
 
-void configure(DarkHelp::NN & nn, const nlohmann::json & j)
+/** Read the neural network files (or decode the bundle) once.  Every copy of the neural network used by the inference
+ * threads is then loaded from this same model in memory.
+ */
+DarkHelp::ModelCache::SPModel load_model(const nlohmann::json & j)
+{
+	if (j["darkhelp"]["lib"]["network"]["bundle"].empty())
+	{
+		std::string cfg_filename		= j["darkhelp"]["lib"]["network"]["cfg"		];
+		std::string weights_filename	= j["darkhelp"]["lib"]["network"]["weights"	];
+		std::string names_filename		= j["darkhelp"]["lib"]["network"]["names"	];
+
+		// darknet behaves very badly if the .cfg and .weights are swapped, so verify (and fix) the order of the files
+		DarkHelp::verify_cfg_and_weights(cfg_filename, weights_filename, names_filename);
+
+		return DarkHelp::ModelCache::load(cfg_filename, weights_filename, names_filename);
+	}
+
+	return DarkHelp::ModelCache::load(
+		j["darkhelp"]["lib"]["network"]["bundle"		].get<std::string>(),
+		j["darkhelp"]["lib"]["network"]["bundle_key"	].get<std::string>());
+}
+
+
+void configure(DarkHelp::NN & nn, const nlohmann::json & j, const DarkHelp::ModelCache::SPModel & model, const bool verbose = true)
 {
 	// this one needs to be set prior to loading the network
 	nn.config.modify_batch_and_subdivisions = j["darkhelp"]["lib"]["settings"]["general"]["modify_batch_and_subdivisions"];
@@ -111,35 +195,26 @@ void configure(DarkHelp::NN & nn, const nlohmann::json & j)
 		throw std::invalid_argument("driver name \"" + driver_name + "\" is invalid");
 	}
 
-	if (j["darkhelp"]["lib"]["network"]["bundle"].empty())
-	{
-		nn.init(
-			j["darkhelp"]["lib"]["network"]["cfg"		],
-			j["darkhelp"]["lib"]["network"]["weights"	],
-			j["darkhelp"]["lib"]["network"]["names"		],
-			true,
-			driver);
-	}
-	else
-	{
-		nn.init(false, j["darkhelp"]["lib"]["network"]["bundle"], j["darkhelp"]["lib"]["network"]["bundle_key"], driver);
-	}
+	nn.init_from_memory(model->cfg, model->names, model->weights, driver);
 
 	if (j["darkhelp"]["lib"]["settings"]["general"]["debug"])
 	{
 		nn.config.enable_debug = true;
 	}
 
-	std::cout
-		<< "-> using DarkHelp v"		<< DarkHelp::version()	<< std::endl
-		<< "-> using driver \""			<< driver_name << "\""	<< std::endl
-		<< "-> network loaded in "		<< nn.duration_string()	<< std::endl
-		<< "-> network dimensions: "	<< nn.network_size()	<< std::endl
-		<< "-> number of classes: "		<< nn.names.size()		<< std::endl;
-
-	for (size_t idx = 0; idx < nn.names.size(); idx ++)
+	if (verbose)
 	{
-		std::cout << "   " << idx << " = " << nn.names.at(idx) << std::endl;
+		std::cout
+			<< "-> using DarkHelp v"		<< DarkHelp::version()	<< std::endl
+			<< "-> using driver \""			<< driver_name << "\""	<< std::endl
+			<< "-> network loaded in "		<< nn.duration_string()	<< std::endl
+			<< "-> network dimensions: "	<< nn.network_size()	<< std::endl
+			<< "-> number of classes: "		<< nn.names.size()		<< std::endl;
+
+		for (size_t idx = 0; idx < nn.names.size(); idx ++)
+		{
+			std::cout << "   " << idx << " = " << nn.names.at(idx) << std::endl;
+		}
 	}
 
 	nn.config.threshold							= j["darkhelp"]["lib"]["settings"]["general"]["threshold"];
@@ -240,287 +315,1627 @@ void load_roi(const std::filesystem::path & src)
 }
 
 
-void process_image(DarkHelp::NN & nn, cv::Mat & mat, const std::string & stem)
+bool start_inotify(const std::filesystem::path & input_dir)
 {
-	if (mat.empty())
+	#ifdef __linux__
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0)
 	{
-		return;
+		std::cout << "-> WARNING: failed to initialize inotify (errno=" << errno << "), falling back to polling the input directory" << std::endl;
+		return false;
+	}
+
+	// we only care about files which have been completely written or which have been moved into the input directory
+	const int wd = inotify_add_watch(inotify_fd, input_dir.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd < 0)
+	{
+		std::cout << "-> WARNING: failed to add inotify watch on " << input_dir << " (errno=" << errno << "), falling back to polling the input directory" << std::endl;
+		close(inotify_fd);
+		inotify_fd = -1;
+		return false;
 	}
 
-	const auto now = std::chrono::high_resolution_clock::now();
+	// the first time through we still need to look at the entire directory in case some images already exist
+	inotify_rescan_needed = true;
 
-	total_number_of_images_processed ++;
-	last_activity = now;
+	return true;
+	#else
+	return false;
+	#endif
+}
 
-	const auto results = nn.predict(mat);
 
-	std::string annotated_filename;
-	if (save_annotated_image)
+void wait_for_new_images(const std::filesystem::path & input_dir)
+{
+	#ifdef __linux__
+	if (inotify_fd >= 0)
 	{
-		annotated_filename = stem + "_annotated.jpg";
-		auto annotated_image = nn.annotate();
-		for (const auto & r : roi_rectangles)
+		/* Wait for a maximum of 1 second so the caller has a chance to check for the idle timeout.  Note that events
+		 * which happen while we're not blocked on poll() are queued by the kernel, so new images cannot be missed.
+		 */
+		pollfd pfd;
+		pfd.fd		= inotify_fd;
+		pfd.events	= POLLIN;
+		pfd.revents	= 0;
+		const int rc = poll(&pfd, 1, 1000);
+		if (rc <= 0)
 		{
-			cv::rectangle(annotated_image, r, cv::Scalar(0, 255, 0));
-			cv::rectangle(annotated_image, cv::Point(r.x - 1, r.y - 1), cv::Point(r.x + r.width + 1, r.y + r.height + 1), cv::Scalar(0, 0, 255));
+			return;
 		}
-		cv::imwrite(annotated_filename, annotated_image, {cv::ImwriteFlags::IMWRITE_JPEG_QUALITY, 70});
-	}
 
-	std::string txt_filename;
-	if (save_txt_annotations)
-	{
-		txt_filename = stem + ".txt";
-		std::ofstream ofs(txt_filename);
-		ofs << std::fixed << std::setprecision(10);
-		for (const auto & prediction : results)
+		alignas(inotify_event) char buffer[4096];
+		while (true)
 		{
-			ofs	<< prediction.best_class			<< " "
-				<< prediction.original_point.x		<< " "
-				<< prediction.original_point.y		<< " "
-				<< prediction.original_size.width	<< " "
-				<< prediction.original_size.height	<< std::endl;
+			const auto len = read(inotify_fd, buffer, sizeof(buffer));
+			if (len <= 0)
+			{
+				// EAGAIN means we've drained all of the queued events
+				break;
+			}
+
+			for (ssize_t idx = 0; idx < len; )
+			{
+				const inotify_event * event = reinterpret_cast<const inotify_event *>(buffer + idx);
+				idx += sizeof(inotify_event) + event->len;
+
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					// the kernel dropped some events, so we need to look at the entire directory to find what was missed
+					inotify_rescan_needed = true;
+				}
+				else if (event->mask & IN_IGNORED)
+				{
+					std::cout << "-> WARNING: inotify watch on " << input_dir << " was removed, falling back to polling the input directory" << std::endl;
+					close(inotify_fd);
+					inotify_fd = -1;
+					inotify_pending_files.clear();
+					return;
+				}
+				else if (event->len > 0 and (event->mask & IN_ISDIR) == 0)
+				{
+					inotify_pending_files.push_back(input_dir / event->name);
+				}
+			}
 		}
+
+		return;
 	}
+	#endif
+
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+
+	return;
+}
 
-	if (save_json_results)
-	{
-		nlohmann::json output;
 
-		const auto epoch			= now.time_since_epoch();
-		const auto nanoseconds		= std::chrono::duration_cast<std::chrono::nanoseconds>	(epoch).count();
-		const std::time_t seconds	= std::chrono::duration_cast<std::chrono::seconds>		(epoch).count();
-		const auto lt				= std::localtime(&seconds);
-		char buffer[50];
-		std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S %z", lt);
+/** Keeps track of the jobs submitted by one source of images.  The main loop uses this to wait until the output files
+ * for its own images have been saved, without also waiting for the images submitted through the HTTP listener or
+ * shared memory, which may never stop arriving.
+ */
+class JobCounter final
+{
+	public:
+
+		JobCounter() :
+			jobs_outstanding(0),
+			jobs_completed(0)
+		{
+			return;
+		}
 
-		output["timestamp"]["nanoseconds"	] = nanoseconds;
-		output["timestamp"]["epoch"			] = seconds;
-		output["timestamp"]["text"			] = buffer;
+		/// Must be called before the job is pushed onto the inference queue.
+		void submitted()
+		{
+			std::scoped_lock lock(counter_lock);
+			jobs_outstanding ++;
 
-		output["index"				] = total_number_of_images_processed;
-		output["duration"			] = nn.duration_string();
-		output["tiles"]["horizontal"] = nn.horizontal_tiles;
-		output["tiles"]["vertical"	] = nn.vertical_tiles;
-		output["tiles"]["width"		] = nn.tile_size.width;
-		output["tiles"]["height"	] = nn.tile_size.height;
+			return;
+		}
 
-		if (annotated_filename.empty() == false)
+		/// Must be called once the job has been completely handled, including saving the output files.
+		void finished()
 		{
-			output["annotated_filename"] = annotated_filename;
+			std::scoped_lock lock(counter_lock);
+			jobs_outstanding --;
+			jobs_completed ++;
+			trigger.notify_all();
+
+			return;
 		}
 
-		if (txt_filename.empty() == false)
+		/// Returns once all of the submitted jobs have finished.
+		void wait_until_idle()
 		{
-			output["txt_filename"] = txt_filename;
+			std::unique_lock lock(counter_lock);
+			trigger.wait(lock, [&]{ return jobs_outstanding == 0; });
+
+			return;
 		}
 
-		for (size_t idx = 0; idx < results.size(); idx ++)
+		/// The total number of jobs which have finished.  This is used to calculate the FPS.
+		size_t completed()
 		{
-			const auto & pred = results[idx];
-			auto & j = output["prediction"][idx];
+			std::scoped_lock lock(counter_lock);
 
-			if (crop_and_save_detected_objects)
-			{
-				const auto fn = stem + "_idx_" + std::to_string(idx) + "_class_" + std::to_string(pred.best_class) + ".jpg";
-				j["crop_filename"]			= fn;
-			}
+			return jobs_completed;
+		}
+
+	private:
+
+		size_t jobs_outstanding;
+		size_t jobs_completed;
+		std::mutex counter_lock;
+		std::condition_variable trigger;
+};
+
+
+/** Everything we need to know about an image as it moves from the main thread, to the inference threads, and finally to
+ * the threads responsible for saving the output files.
+ */
+struct ImageJob
+{
+	size_t index;
+	std::chrono::high_resolution_clock::time_point timestamp;
+	cv::Mat mat;
+	std::string stem;
+	std::vector<cv::Rect> roi;
+
+	// the remaining fields are filled in by the inference threads
+	const DarkHelp::VStr * names;
+	DarkHelp::PredictionResults results;
+	cv::Mat annotated_image;
+	std::string duration;
+	size_t horizontal_tiles;
+	size_t vertical_tiles;
+	cv::Size tile_size;
+
+	/** Images submitted through the HTTP listener or shared memory don't save anything to disk.  Instead, this is called
+	 * with the JSON results.  If inference failed, then the JSON is empty and the error message is set.
+	 */
+	std::function<void(const std::string & json, const std::string & error)> reply;
+
+	/// Jobs submitted by the main loop are tracked so it can wait for its own images.
+	JobCounter * counter = nullptr;
+};
+
+
+/** Bounded queue of jobs shared between the main thread and a pool of threads.  When the queue is full, @ref push() will
+ * block, which prevents the main thread from reading images faster than what can be processed.
+ */
+class JobQueue final
+{
+	public:
+
+		JobQueue(const size_t max_size) :
+			max_jobs(std::max(size_t(1), max_size)),
+			stop_requested(false),
+			jobs_in_progress(0)
+		{
+			return;
+		}
+
+		/// Add a new job to the queue.  This will block if the queue is full.
+		void push(std::shared_ptr<ImageJob> job)
+		{
+			std::unique_lock lock(jobs_lock);
+			trigger.wait(lock, [&]{ return stop_requested or jobs.size() < max_jobs; });
+			jobs.push_back(job);
+			trigger.notify_all();
 
-			j["prediction_index"]			= idx;
-			j["name"]						= pred.name;
-			j["best_class"]					= pred.best_class;
-			j["best_probability"]			= pred.best_probability;
-			j["original_size"]["width"]		= pred.original_size.width;
-			j["original_size"]["height"]	= pred.original_size.height;
-			j["original_point"]["x"]		= pred.original_point.x;
-			j["original_point"]["y"]		= pred.original_point.y;
-			j["rect"]["x"]					= pred.rect.x;
-			j["rect"]["y"]					= pred.rect.y;
-			j["rect"]["width"]				= pred.rect.width;
-			j["rect"]["height"]				= pred.rect.height;
+			return;
+		}
 
-			size_t prop_count = 0;
-			for (const auto & prop : pred.all_probabilities)
+		/// Blocks until a job is available.  Returns @p nullptr once @ref stop() has been called and the queue is empty.
+		std::shared_ptr<ImageJob> pop()
+		{
+			std::unique_lock lock(jobs_lock);
+			trigger.wait(lock, [&]{ return stop_requested or jobs.empty() == false; });
+			if (jobs.empty())
 			{
-				j["all_probabilities"][prop_count]["class"			] = prop.first;
-				j["all_probabilities"][prop_count]["probability"	] = prop.second;
-				j["all_probabilities"][prop_count]["name"			] = nn.names[prop.first];
-				prop_count ++;
+				return nullptr;
 			}
 
-			if (apply_roi)
-			{
-				bool roi_found = false;
-				for (const auto & r : roi_rectangles)
-				{
-					const cv::Rect intersection = (r & pred.rect);
-					if (intersection.area() > 0.0f)
-					{
-						// the object detected is in a RoI, so remember this rectangle
-						j["roi"]["x"]				= r.x;
-						j["roi"]["y"]				= r.y;
-						j["roi"]["width"]			= r.width;
-						j["roi"]["height"]			= r.height;
-						roi_found = true;
-						break;
-					}
-				}
+			auto job = jobs.front();
+			jobs.pop_front();
+			jobs_in_progress ++;
+			trigger.notify_all();
 
-				j["detection_is_in_roi"] = roi_found;
-			}
+			return job;
 		}
 
-		std::ofstream ofs(stem + ".json");
-		ofs << output.dump(4) << std::endl;
-	}
+		/// Must be called once for every job returned by @ref pop().
+		void done()
+		{
+			std::scoped_lock lock(jobs_lock);
+			jobs_in_progress --;
+			trigger.notify_all();
 
-	if (crop_and_save_detected_objects)
-	{
-		for (size_t idx = 0; idx < results.size(); idx ++)
+			return;
+		}
+
+		/** Returns once there are no jobs waiting in the queue and at least one of the @p number_of_threads threads handling
+		 * this queue is free to pick up the next job.  Note that waiting for the queue to be empty is not enough, since it
+		 * becomes empty as soon as a busy thread pops the last job, long before that thread is free.
+		 */
+		void wait_for_available_thread(const size_t number_of_threads)
+		{
+			std::unique_lock lock(jobs_lock);
+			trigger.wait(lock, [&]{ return stop_requested or (jobs.empty() and jobs_in_progress < number_of_threads); });
+
+			return;
+		}
+
+		/// Returns once all of the jobs in the queue have been handled.
+		void wait_until_idle()
+		{
+			std::unique_lock lock(jobs_lock);
+			trigger.wait(lock, [&]{ return jobs.empty() and jobs_in_progress == 0; });
+
+			return;
+		}
+
+		/// Wake up all the threads waiting on this queue so they can exit once the remaining jobs have been handled.
+		void stop()
 		{
-			const auto & prediction = results[idx];
-			const auto fn = stem + "_idx_" + std::to_string(idx) + "_class_" + std::to_string(prediction.best_class) + ".jpg";
-			cv::imwrite(fn, mat(prediction.rect), {cv::ImwriteFlags::IMWRITE_JPEG_QUALITY, 70});
+			std::scoped_lock lock(jobs_lock);
+			stop_requested = true;
+			trigger.notify_all();
+
+			return;
 		}
+
+	private:
+
+		const size_t max_jobs;
+		bool stop_requested;
+		size_t jobs_in_progress;
+		std::deque<std::shared_ptr<ImageJob>> jobs;
+		std::mutex jobs_lock;
+		std::condition_variable trigger;
+};
+
+
+void run_inference(DarkHelp::NN & nn, ImageJob & job)
+{
+	job.results				= nn.predict(job.mat);
+	job.names				= &nn.names;
+	job.duration			= nn.duration_string();
+	job.horizontal_tiles	= nn.horizontal_tiles;
+	job.vertical_tiles		= nn.vertical_tiles;
+	job.tile_size			= nn.tile_size;
+
+	if (save_annotated_image and job.reply == nullptr)
+	{
+		// the annotations must be created by the same neural network that ran inference on this image
+		job.annotated_image = nn.annotate();
 	}
 
 	return;
 }
 
 
-void server(DarkHelp::NN & nn, const nlohmann::json & j)
+nlohmann::json create_json_results(const ImageJob & job)
 {
-	const auto & server_settings = j["darkhelp"]["server"]["settings"];
+	nlohmann::json output;
 
-	auto input_dir		= std::filesystem::path(server_settings["input_directory"].get<std::string>());
-	auto output_dir		= std::filesystem::path(server_settings["output_directory"].get<std::string>());
-
-	if (server_settings["clear_output_directory_on_startup"])
+	const auto epoch			= job.timestamp.time_since_epoch();
+	const auto nanoseconds		= std::chrono::duration_cast<std::chrono::nanoseconds>	(epoch).count();
+	const std::time_t seconds	= std::chrono::duration_cast<std::chrono::seconds>		(epoch).count();
+	std::tm lt;
+	if (true)
 	{
-		std::filesystem::remove_all(output_dir);
+		// std::localtime() uses a static buffer, and this may be called by multiple threads at once
+		static std::mutex localtime_lock;
+		std::scoped_lock lock(localtime_lock);
+		lt = *std::localtime(&seconds);
 	}
+	char buffer[50];
+	std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S %z", &lt);
 
-	std::filesystem::create_directories(input_dir);
-	std::filesystem::create_directories(output_dir);
+	output["timestamp"]["nanoseconds"	] = nanoseconds;
+	output["timestamp"]["epoch"			] = seconds;
+	output["timestamp"]["text"			] = buffer;
 
-	std::cout << "-> DarkHelp Server is now running..." << std::endl;
+	output["index"				] = job.index;
+	output["duration"			] = job.duration;
+	output["tiles"]["horizontal"] = job.horizontal_tiles;
+	output["tiles"]["vertical"	] = job.vertical_tiles;
+	output["tiles"]["width"		] = job.tile_size.width;
+	output["tiles"]["height"	] = job.tile_size.height;
 
-	const auto idle_timeout_in_seconds = std::chrono::seconds(server_settings["idle_time_in_seconds"]);
-	const bool exit_if_idle								= server_settings["exit_if_idle"					];
-	const int max_images_to_process_at_once				= server_settings["max_images_to_process_at_once"	];
-	const bool purge_files_after_cmd_completes			= server_settings["purge_files_after_cmd_completes"	];
-	const std::string run_cmd_after_processing_images	= server_settings["run_cmd_after_processing_images"	];
-	const bool use_camera_for_input						= server_settings["use_camera_for_input"			];
-	crop_and_save_detected_objects						= server_settings["crop_and_save_detected_objects"	];
-	save_annotated_image								= server_settings["save_annotated_image"			];
-	save_txt_annotations								= server_settings["save_txt_annotations"			];
-	save_json_results									= server_settings["save_json_results"				];
-	apply_roi											= server_settings["apply_roi"						] ;
-	const bool save_original_image						= server_settings["camera"]["save_original_image"	];
+	// images which were submitted through the HTTP listener don't have any output files
+	const bool files_saved = (job.reply == nullptr);
 
-	cv::VideoCapture cap;
-	if (use_camera_for_input)
+	if (save_annotated_image and files_saved)
 	{
-		const auto & camera = server_settings["camera"];
+		output["annotated_filename"] = job.stem + "_annotated.jpg";
+	}
 
-		std::string name	= camera["name"			];
-		int bufferSize		= camera["buffersize"	];
-		int width			= camera["width"		];
-		int height			= camera["height"		];
-		int fps				= camera["fps"			];
+	if (save_txt_annotations and files_saved)
+	{
+		output["txt_filename"] = job.stem + ".txt";
+	}
 
-		std::cout << "-> configuring camera device \"" << name << "\" to use " << width << " x " << height << " @ " << fps << " FPS with a buffer size of " << bufferSize << std::endl;
-		if (name.empty() == false and name[0] >= '0' and name[0] <= '9')
+	for (size_t idx = 0; idx < job.results.size(); idx ++)
+	{
+		const auto & pred = job.results[idx];
+		auto & j = output["prediction"][idx];
+
+		if (crop_and_save_detected_objects and files_saved)
 		{
-			int index = std::stoi(name);
-			cap.open(index);
+			const auto fn = job.stem + "_idx_" + std::to_string(idx) + "_class_" + std::to_string(pred.best_class) + ".jpg";
+			j["crop_filename"]			= fn;
 		}
-		else
+
+		j["prediction_index"]			= idx;
+		j["name"]						= pred.name;
+		j["best_class"]					= pred.best_class;
+		j["best_probability"]			= pred.best_probability;
+		j["original_size"]["width"]		= pred.original_size.width;
+		j["original_size"]["height"]	= pred.original_size.height;
+		j["original_point"]["x"]		= pred.original_point.x;
+		j["original_point"]["y"]		= pred.original_point.y;
+		j["rect"]["x"]					= pred.rect.x;
+		j["rect"]["y"]					= pred.rect.y;
+		j["rect"]["width"]				= pred.rect.width;
+		j["rect"]["height"]				= pred.rect.height;
+
+		size_t prop_count = 0;
+		for (const auto & prop : pred.all_probabilities)
 		{
-			cap.open(name);
+			j["all_probabilities"][prop_count]["class"			] = prop.first;
+			j["all_probabilities"][prop_count]["probability"	] = prop.second;
+			j["all_probabilities"][prop_count]["name"			] = job.names->at(prop.first);
+			prop_count ++;
 		}
-		if (cap.isOpened() == false)
+
+		if (apply_roi)
 		{
-			throw std::invalid_argument("failed to open camera device " + name);
+			bool roi_found = false;
+			for (const auto & r : job.roi)
+			{
+				const cv::Rect intersection = (r & pred.rect);
+				if (intersection.area() > 0.0f)
+				{
+					// the object detected is in a RoI, so remember this rectangle
+					j["roi"]["x"]				= r.x;
+					j["roi"]["y"]				= r.y;
+					j["roi"]["width"]			= r.width;
+					j["roi"]["height"]			= r.height;
+					roi_found = true;
+					break;
+				}
+			}
+
+			j["detection_is_in_roi"] = roi_found;
 		}
-		cap.set(cv::VideoCaptureProperties::CAP_PROP_BUFFERSIZE		, bufferSize	);
-		cap.set(cv::VideoCaptureProperties::CAP_PROP_FRAME_WIDTH	, width			);
-		cap.set(cv::VideoCaptureProperties::CAP_PROP_FRAME_HEIGHT	, height		);
-		cap.set(cv::VideoCaptureProperties::CAP_PROP_FPS			, fps			);
+	}
 
-		cv::Mat mat;
-		cap >> mat;
-		if (mat.empty())
+	return output;
+}
+
+
+void save_results(ImageJob & job)
+{
+	if (save_annotated_image and not job.annotated_image.empty())
+	{
+		for (const auto & r : job.roi)
 		{
-			std::cout << "WARNING: reading from camera device " << name << " is returning empty frames" << std::endl;
+			cv::rectangle(job.annotated_image, r, cv::Scalar(0, 255, 0));
+			cv::rectangle(job.annotated_image, cv::Point(r.x - 1, r.y - 1), cv::Point(r.x + r.width + 1, r.y + r.height + 1), cv::Scalar(0, 0, 255));
 		}
+		cv::imwrite(job.stem + "_annotated.jpg", job.annotated_image, {cv::ImwriteFlags::IMWRITE_JPEG_QUALITY, 70});
+	}
 
-		bufferSize	= cap.get(cv::VideoCaptureProperties::CAP_PROP_BUFFERSIZE	);
-		width		= cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_WIDTH	);
-		height		= cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_HEIGHT	);
-		fps			= cap.get(cv::VideoCaptureProperties::CAP_PROP_FPS			);
-		std::cout << "-> camera device " + name + " is reporting " << width << " x " << height << " @ " << fps << " FPS with a buffer size of " << bufferSize << std::endl;
-		std::cout << "-> actual frame from camera device " + name + " measures " << mat.cols << " x " << mat.rows << std::endl;
+	if (save_txt_annotations)
+	{
+		std::ofstream ofs(job.stem + ".txt");
+		ofs << std::fixed << std::setprecision(10);
+		for (const auto & prediction : job.results)
+		{
+			ofs	<< prediction.best_class			<< " "
+				<< prediction.original_point.x		<< " "
+				<< prediction.original_point.y		<< " "
+				<< prediction.original_size.width	<< " "
+				<< prediction.original_size.height	<< std::endl;
+		}
 	}
-	else
+
+	if (save_json_results)
 	{
-		std::cout << "-> reading images from directory " << input_dir.string() << std::endl;
+		std::ofstream ofs(job.stem + ".json");
+		ofs << create_json_results(job).dump(4) << std::endl;
 	}
 
-	int images_processed = 0;
-	std::filesystem::directory_iterator dir_iter;
+	if (crop_and_save_detected_objects)
+	{
+		for (size_t idx = 0; idx < job.results.size(); idx ++)
+		{
+			const auto & prediction = job.results[idx];
+			const auto fn = job.stem + "_idx_" + std::to_string(idx) + "_class_" + std::to_string(prediction.best_class) + ".jpg";
+			cv::imwrite(fn, job.mat(prediction.rect), {cv::ImwriteFlags::IMWRITE_JPEG_QUALITY, 70});
+		}
+	}
+
+	return;
+}
+
 
+void inference_thread(const size_t id, DarkHelp::NN & nn, JobQueue & inference_queue, JobQueue & writer_queue, const bool use_writer_threads)
+{
 	while (true)
 	{
-		const auto now = std::chrono::high_resolution_clock::now();
-
-		if (exit_if_idle and now > last_activity + idle_timeout_in_seconds)
+		auto job = inference_queue.pop();
+		if (not job)
 		{
-			std::cout << "-> idle timeout detected after " << idle_timeout_in_seconds.count() << " seconds" << std::endl;
 			break;
 		}
 
-		cv::Mat mat;
-		std::string dst_stem;
+		bool handed_to_writer = false;
 
-		if (use_camera_for_input)
+		try
 		{
-			cap >> mat;
-			dst_stem = (output_dir / ("frame_" + std::to_string(total_number_of_images_processed))).string();
+			run_inference(nn, *job);
 
-			if (save_original_image and not mat.empty())
+			if (job->reply)
 			{
-				cv::imwrite(dst_stem + ".jpg", mat, {cv::ImwriteFlags::IMWRITE_JPEG_QUALITY, 70});
+				job->reply(create_json_results(*job).dump(4), "");
 			}
-		}
-		else
-		{
-			if (dir_iter == std::filesystem::directory_iterator())
+			else if (use_writer_threads)
 			{
-				dir_iter = std::filesystem::directory_iterator(
-					input_dir														,
-					std::filesystem::directory_options::follow_directory_symlink	|
-					std::filesystem::directory_options::skip_permission_denied		);
+				writer_queue.push(job);
+				handed_to_writer = true;
 			}
-
-			if (dir_iter != std::filesystem::directory_iterator())
+			else
 			{
-				auto src = dir_iter->path();
-				dir_iter ++;
-
-				if (std::filesystem::exists(src) == false)
+				save_results(*job);
+			}
+		}
+		catch (const std::exception & e)
+		{
+			std::cout << "-> inference thread #" << id << " failed to process image #" << job->index << ": " << e.what() << std::endl;
+			if (job->reply)
+			{
+				try
 				{
-					// file has since been deleted -- nothing we can do but move on
-					if (src.extension() != ".roi")
-					{
-						std::cout << "skipping (no longer exists?): " << src << std::endl;
-					}
-					continue;
+					job->reply("", e.what());
 				}
+				catch (...)
+				{
+					// the reply was already sent -- nothing else we can do
+				}
+			}
+		}
 
-				std::cout << "-> [" << total_number_of_images_processed << "] " << src.string() << std::endl;
-				auto dst = output_dir / src.filename();
-				dst_stem = (output_dir / src.stem()).string();
+		if (job->counter and not handed_to_writer)
+		{
+			job->counter->finished();
+		}
+		inference_queue.done();
+	}
+
+	return;
+}
+
+
+void writer_thread(const size_t id, JobQueue & writer_queue)
+{
+	while (true)
+	{
+		auto job = writer_queue.pop();
+		if (not job)
+		{
+			break;
+		}
+
+		try
+		{
+			save_results(*job);
+		}
+		catch (const std::exception & e)
+		{
+			std::cout << "-> writer thread #" << id << " failed to save results for image #" << job->index << ": " << e.what() << std::endl;
+		}
+
+		if (job->counter)
+		{
+			job->counter->finished();
+		}
+		writer_queue.done();
+	}
+
+	return;
+}
+
+
+#ifndef WIN32
+/** Minimal HTTP/1.1 listener so clients can submit images directly to %DarkHelp Server without going through the input
+ * and output directories.  This can listen on a Unix domain socket, on a TCP port bound to the loopback interface, or
+ * both.  Each connection is handled on its own thread and supports keep-alive, so a client can send many requests over
+ * the same connection.  Clients send the encoded image (JPG, PNG, ...) as the body of a @p "POST /predict" request, and
+ * the response is the same JSON that would have been written to the output directory.
+ */
+class RequestListener final
+{
+	public:
+
+		RequestListener(JobQueue & q, const size_t max_size) :
+			inference_queue(q),
+			max_body_size(max_size),
+			stop_requested(false)
+		{
+			return;
+		}
+
+		~RequestListener()
+		{
+			stop();
+
+			return;
+		}
+
+		void listen_on_unix_socket(const std::filesystem::path & path)
+		{
+			if (path.string().size() >= sizeof(sockaddr_un::sun_path))
+			{
+				throw std::invalid_argument("unix socket name is too long: " + path.string());
+			}
+
+			// a previous instance of the server may have left the socket behind
+			std::filesystem::remove(path);
+
+			const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (fd < 0)
+			{
+				throw std::runtime_error("failed to create unix socket (errno=" + std::to_string(errno) + ")");
+			}
+
+			sockaddr_un addr = {};
+			addr.sun_family = AF_UNIX;
+			std::strncpy(addr.sun_path, path.string().c_str(), sizeof(addr.sun_path) - 1);
+
+			if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 or listen(fd, SOMAXCONN) != 0)
+			{
+				close(fd);
+				throw std::runtime_error("failed to listen on unix socket " + path.string() + " (errno=" + std::to_string(errno) + ")");
+			}
+
+			unix_socket_filename = path;
+			std::cout << "-> listening for requests on unix socket " << path.string() << std::endl;
+			start(fd);
+
+			return;
+		}
+
+		void listen_on_tcp_port(const int port)
+		{
+			const int fd = socket(AF_INET, SOCK_STREAM, 0);
+			if (fd < 0)
+			{
+				throw std::runtime_error("failed to create TCP socket (errno=" + std::to_string(errno) + ")");
+			}
+
+			const int enable = 1;
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+			// this is only meant for local clients, so we never bind to anything other than the loopback interface
+			sockaddr_in addr = {};
+			addr.sin_family			= AF_INET;
+			addr.sin_port			= htons(port);
+			addr.sin_addr.s_addr	= htonl(INADDR_LOOPBACK);
+
+			if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 or listen(fd, SOMAXCONN) != 0)
+			{
+				close(fd);
+				throw std::runtime_error("failed to listen on TCP port " + std::to_string(port) + " (errno=" + std::to_string(errno) + ")");
+			}
+
+			std::cout << "-> listening for requests on http://127.0.0.1:" << port << "/predict" << std::endl;
+			start(fd);
+
+			return;
+		}
+
+		/// Stop listening, and wait for all the open connections to finish handling their current request.
+		void stop()
+		{
+			stop_requested = true;
+
+			for (auto & t : listener_threads)
+			{
+				t.join();
+			}
+			listener_threads.clear();
+
+			if (true)
+			{
+				std::scoped_lock lock(connections_lock);
+				for (auto & c : connections)
+				{
+					c->thread.join();
+				}
+				connections.clear();
+			}
+
+			if (not unix_socket_filename.empty())
+			{
+				std::filesystem::remove(unix_socket_filename);
+				unix_socket_filename.clear();
+			}
+
+			return;
+		}
+
+	private:
+
+		void start(const int fd)
+		{
+			#ifdef DARKHELP_IGNORE_SIGPIPE
+			std::signal(SIGPIPE, SIG_IGN);
+			#endif
+
+			listener_threads.emplace_back(&RequestListener::accept_connections, this, fd);
+
+			return;
+		}
+
+		/// Wait for up to 500 milliseconds for the socket to be readable, so we periodically get to check @ref stop_requested.
+		static bool wait_for_data(const int fd)
+		{
+			pollfd pfd;
+			pfd.fd		= fd;
+			pfd.events	= POLLIN;
+			pfd.revents	= 0;
+
+			return poll(&pfd, 1, 500) > 0;
+		}
+
+		void accept_connections(const int listen_fd)
+		{
+			while (not stop_requested)
+			{
+				if (not wait_for_data(listen_fd))
+				{
+					continue;
+				}
+
+				const int fd = accept(listen_fd, nullptr, nullptr);
+				if (fd < 0)
+				{
+					continue;
+				}
+
+				#ifdef SO_NOSIGPIPE
+				const int enable = 1;
+				setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+				#endif
+
+				std::scoped_lock lock(connections_lock);
+
+				// forget about the connections which have since been closed
+				for (auto iter = connections.begin(); iter != connections.end(); )
+				{
+					if ((*iter)->finished)
+					{
+						(*iter)->thread.join();
+						iter = connections.erase(iter);
+					}
+					else
+					{
+						iter ++;
+					}
+				}
+
+				connections.push_back(std::make_unique<Connection>());
+				auto & c = *connections.back();
+				c.thread = std::thread(&RequestListener::handle_connection, this, fd, std::ref(c.finished));
+			}
+
+			close(listen_fd);
+
+			return;
+		}
+
+		static bool send_all(const int fd, const std::string & data)
+		{
+			size_t offset = 0;
+			while (offset < data.size())
+			{
+				const auto len = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+				if (len <= 0)
+				{
+					return false;
+				}
+				offset += len;
+			}
+
+			return true;
+		}
+
+		static bool send_response(const int fd, const int status, const std::string & reason, const std::string & body, const bool keep_alive)
+		{
+			const std::string header =
+				"HTTP/1.1 " + std::to_string(status) + " " + reason	+ "\r\n"
+				"Content-Type: application/json"					"\r\n"
+				"Content-Length: " + std::to_string(body.size())	+ "\r\n"
+				"Connection: " + (keep_alive ? "keep-alive" : "close") + "\r\n"
+				"\r\n";
+
+			return send_all(fd, header + body);
+		}
+
+		static std::string error_json(const std::string & msg)
+		{
+			nlohmann::json j;
+			j["error"] = msg;
+
+			return j.dump(4);
+		}
+
+		void handle_connection(const int fd, std::atomic<bool> & finished)
+		{
+			try
+			{
+				handle_requests(fd);
+			}
+			catch (const std::exception & e)
+			{
+				std::cout << "-> closing connection due to exception: " << e.what() << std::endl;
+			}
+
+			close(fd);
+			finished = true;
+
+			return;
+		}
+
+		void handle_requests(const int fd)
+		{
+			std::string buffer;
+			char tmp[64 * 1024];
+
+			// keep handling requests on this connection until the client closes it or asks us to close it
+			bool keep_alive = true;
+			while (keep_alive and not stop_requested)
+			{
+				// read until we have the full header block
+				size_t header_end = buffer.find("\r\n\r\n");
+				bool connection_lost = false;
+				while (header_end == std::string::npos and not stop_requested)
+				{
+					if (buffer.size() > 64 * 1024)
+					{
+						send_response(fd, 431, "Request Header Fields Too Large", error_json("headers are too large"), false);
+						connection_lost = true;
+						break;
+					}
+					if (not wait_for_data(fd))
+					{
+						continue;
+					}
+					const auto len = recv(fd, tmp, sizeof(tmp), 0);
+					if (len <= 0)
+					{
+						connection_lost = true;
+						break;
+					}
+					buffer.append(tmp, len);
+					header_end = buffer.find("\r\n\r\n");
+				}
+				if (connection_lost or header_end == std::string::npos)
+				{
+					break;
+				}
+
+				std::string method;
+				std::string path;
+				std::string version;
+				size_t content_length = 0;
+				bool invalid_content_length = false;
+				std::string connection;
+				std::string transfer_encoding;
+
+				std::istringstream iss(buffer.substr(0, header_end));
+				std::string line;
+				std::getline(iss, line);
+				std::istringstream(line) >> method >> path >> version;
+				while (std::getline(iss, line))
+				{
+					const auto pos = line.find(':');
+					if (pos == std::string::npos)
+					{
+						continue;
+					}
+					std::string key = line.substr(0, pos);
+					std::string val = line.substr(pos + 1);
+					std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+					std::transform(val.begin(), val.end(), val.begin(), [](unsigned char c) { return std::tolower(c); });
+					val.erase(0, val.find_first_not_of(" \t"));
+					val.erase(val.find_last_not_of(" \t\r") + 1);
+
+					if (key == "content-length")
+					{
+						// std::stoul() would accept things like "+5", "12abc", or throw on garbage, so validate it ourselves
+						if (val.empty() or val.size() > 18 or val.find_first_not_of("0123456789") != std::string::npos)
+						{
+							invalid_content_length = true;
+						}
+						else
+						{
+							content_length = std::stoull(val);
+						}
+					}
+					else if (key == "connection")
+					{
+						connection = val;
+					}
+					else if (key == "transfer-encoding")
+					{
+						transfer_encoding = val;
+					}
+				}
+				buffer.erase(0, header_end + 4);
+
+				// HTTP/1.1 defaults to keep-alive, while HTTP/1.0 defaults to closing the connection
+				keep_alive = (version == "HTTP/1.1" ? connection != "close" : connection == "keep-alive");
+
+				/* In both of these cases we don't know where the body ends, so we cannot find the start of the next request.
+				 * The connection must be closed after the error response has been sent.
+				 */
+				if (invalid_content_length)
+				{
+					send_response(fd, 400, "Bad Request", error_json("invalid Content-Length"), false);
+					break;
+				}
+				if (not transfer_encoding.empty())
+				{
+					send_response(fd, 501, "Not Implemented", error_json("Transfer-Encoding \"" + transfer_encoding + "\" is not supported; send the image with a Content-Length"), false);
+					break;
+				}
+
+				if (content_length > max_body_size)
+				{
+					send_response(fd, 413, "Payload Too Large", error_json("image is larger than " + std::to_string(max_body_size) + " bytes"), false);
+					break;
+				}
+
+				// read the body -- some of it may already be in the buffer
+				while (buffer.size() < content_length and not stop_requested)
+				{
+					if (not wait_for_data(fd))
+					{
+						continue;
+					}
+					const auto len = recv(fd, tmp, sizeof(tmp), 0);
+					if (len <= 0)
+					{
+						connection_lost = true;
+						break;
+					}
+					buffer.append(tmp, len);
+				}
+				if (connection_lost or buffer.size() < content_length)
+				{
+					break;
+				}
+
+				const std::string body = buffer.substr(0, content_length);
+				buffer.erase(0, content_length);
+
+				bool ok = false;
+				if (path != "/predict" and path != "/")
+				{
+					ok = send_response(fd, 404, "Not Found", error_json("unknown path " + path), keep_alive);
+				}
+				else if (method != "POST")
+				{
+					ok = send_response(fd, 405, "Method Not Allowed", error_json("expected POST with an encoded image"), keep_alive);
+				}
+				else
+				{
+					ok = process_request(fd, body, keep_alive);
+				}
+
+				if (not ok)
+				{
+					break;
+				}
+			}
+
+			return;
+		}
+
+		bool process_request(const int fd, const std::string & body, const bool keep_alive)
+		{
+			cv::Mat mat;
+			try
+			{
+				const cv::Mat raw(1, body.size(), CV_8UC1, const_cast<char *>(body.data()));
+				mat = cv::imdecode(raw, cv::IMREAD_COLOR);
+			}
+			catch (...)
+			{
+			}
+
+			if (mat.empty())
+			{
+				return send_response(fd, 400, "Bad Request", error_json("failed to decode image"), keep_alive);
+			}
+
+			const auto now = std::chrono::high_resolution_clock::now();
+			last_activity = now;
+
+			auto job = std::make_shared<ImageJob>();
+			job->index		= ++ total_number_of_images_processed;
+			job->timestamp	= now;
+			job->mat		= mat;
+
+			auto promise	= std::make_shared<std::promise<std::string>>();
+			auto reply		= promise->get_future();
+			job->reply		= [promise](const std::string & json, const std::string & error)
+			{
+				if (error.empty())
+				{
+					promise->set_value(json);
+				}
+				else
+				{
+					promise->set_exception(std::make_exception_ptr(std::runtime_error(error)));
+				}
+			};
+
+			inference_queue.push(job);
+
+			try
+			{
+				return send_response(fd, 200, "OK", reply.get(), keep_alive);
+			}
+			catch (const std::exception & e)
+			{
+				return send_response(fd, 500, "Internal Server Error", error_json(e.what()), keep_alive);
+			}
+		}
+
+		JobQueue & inference_queue;
+		const size_t max_body_size;
+		std::atomic<bool> stop_requested;
+		std::filesystem::path unix_socket_filename;
+		std::vector<std::thread> listener_threads;
+
+		struct Connection
+		{
+			std::thread thread;
+			std::atomic<bool> finished = false;
+		};
+		std::list<std::unique_ptr<Connection>> connections;
+		std::mutex connections_lock;
+};
+#endif
+
+
+#ifdef __linux__
+/** Creates a POSIX shared memory object which co-located applications use to submit raw BGR video frames without any
+ * encoding, sockets, or files.  Inference runs directly on the shared memory, and the JSON results are written back to a
+ * matching ring of result slots.  See @p DarkHelpSharedMemory.hpp for details on the layout and the protocol.
+ */
+class SharedMemoryListener final
+{
+	public:
+
+		SharedMemoryListener(JobQueue & q) :
+			inference_queue(q),
+			stop_requested(false),
+			frame_timeout(std::chrono::seconds(2)),
+			shm_fd(-1),
+			shm_size(0),
+			shm(nullptr),
+			header(nullptr)
+		{
+			return;
+		}
+
+		~SharedMemoryListener()
+		{
+			stop();
+
+			return;
+		}
+
+		void start(const std::string & name, const size_t number_of_slots, const size_t max_frame_size, const size_t max_result_size, const size_t frame_timeout_in_milliseconds)
+		{
+			if (number_of_slots < 1 or number_of_slots > 1024)
+			{
+				throw std::invalid_argument("number of shared memory slots seems to be unusual: " + std::to_string(number_of_slots));
+			}
+			if (frame_timeout_in_milliseconds < 10 or frame_timeout_in_milliseconds > 3600000)
+			{
+				throw std::invalid_argument("shared memory frame timeout seems to be unusual: " + std::to_string(frame_timeout_in_milliseconds));
+			}
+			frame_timeout = std::chrono::milliseconds(frame_timeout_in_milliseconds);
+
+			using namespace DarkHelp::SharedMemory;
+
+			// round everything up to a multiple of 64 bytes so the pixel data and each of the slots start on a cache line
+			auto align = [](const size_t size) { return (size + 63) / 64 * 64; };
+
+			const size_t frame_slot_size	= align(sizeof(FrameSlot) + max_frame_size);
+			const size_t result_slot_size	= align(sizeof(ResultSlot) + max_result_size);
+			const size_t frame_slots_offset	= align(sizeof(Header));
+			const size_t result_slots_offset= frame_slots_offset + number_of_slots * frame_slot_size;
+			shm_size						= result_slots_offset + number_of_slots * result_slot_size;
+
+			// a previous instance of the server may have left the shared memory object behind
+			shm_unlink(name.c_str());
+			shm_fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+			if (shm_fd < 0)
+			{
+				throw std::runtime_error("failed to create shared memory object " + name + " (errno=" + std::to_string(errno) + ")");
+			}
+			shm_name = name;
+
+			if (ftruncate(shm_fd, shm_size) != 0)
+			{
+				throw std::runtime_error("failed to resize shared memory object " + name + " to " + std::to_string(shm_size) + " bytes (errno=" + std::to_string(errno) + ")");
+			}
+
+			void * ptr = mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+			if (ptr == MAP_FAILED)
+			{
+				throw std::runtime_error("failed to map shared memory object " + name + " (errno=" + std::to_string(errno) + ")");
+			}
+			shm = reinterpret_cast<uint8_t *>(ptr);
+
+			// ftruncate() guarantees the memory is zero-filled, so the slot sequence numbers all start at zero
+			header = new (shm) Header;
+			header->number_of_slots		= number_of_slots;
+			header->frame_timeout_ms	= frame_timeout_in_milliseconds;
+			header->frame_slot_size		= frame_slot_size;
+			header->frame_slots_offset	= frame_slots_offset;
+			header->result_slot_size	= result_slot_size;
+			header->result_slots_offset	= result_slots_offset;
+			header->next_sequence		= 1;
+			for (size_t idx = 0; idx < number_of_slots; idx ++)
+			{
+				new (frame_slot(idx)) FrameSlot;
+				new (result_slot(idx)) ResultSlot;
+			}
+			if (sem_init(&header->frames_available, 1, 0) != 0)
+			{
+				throw std::runtime_error("failed to initialize semaphore in shared memory object " + name + " (errno=" + std::to_string(errno) + ")");
+			}
+
+			// set these last -- producers will wait until they see a valid magic value before doing anything else
+			header->version	= kVersion;
+			std::atomic_thread_fence(std::memory_order_release);
+			header->magic	= kMagic;
+
+			std::cout << "-> reading frames from shared memory " << name << " (" << number_of_slots << " slots, " << shm_size << " bytes)" << std::endl;
+			listener_thread = std::thread(&SharedMemoryListener::run, this);
+
+			return;
+		}
+
+		void stop()
+		{
+			stop_requested = true;
+			if (listener_thread.joinable())
+			{
+				listener_thread.join();
+			}
+
+			// we cannot unmap the memory while inference threads may still be using the frames
+			inference_queue.wait_until_idle();
+
+			if (header)
+			{
+				/* Producers may still be posting the semaphore or waiting on the futexes, so none of it is destroyed.
+				 * Instead, clear the magic value and wake up any producer waiting for results which will never come.
+				 */
+				header->magic = 0;
+				for (size_t idx = 0; idx < header->number_of_slots; idx ++)
+				{
+					wake(result_slot(idx)->futex);
+				}
+				header = nullptr;
+			}
+			if (shm)
+			{
+				munmap(shm, shm_size);
+				shm = nullptr;
+			}
+			if (shm_fd >= 0)
+			{
+				close(shm_fd);
+				shm_fd = -1;
+			}
+			if (not shm_name.empty())
+			{
+				shm_unlink(shm_name.c_str());
+				shm_name.clear();
+			}
+
+			return;
+		}
+
+	private:
+
+		DarkHelp::SharedMemory::FrameSlot * frame_slot(const size_t idx)
+		{
+			return reinterpret_cast<DarkHelp::SharedMemory::FrameSlot *>(shm + header->frame_slots_offset + idx * header->frame_slot_size);
+		}
+
+		DarkHelp::SharedMemory::ResultSlot * result_slot(const size_t idx)
+		{
+			return reinterpret_cast<DarkHelp::SharedMemory::ResultSlot *>(shm + header->result_slots_offset + idx * header->result_slot_size);
+		}
+
+		void publish_results(const uint64_t sequence, const std::string & json, const std::string & error)
+		{
+			std::string text = json;
+			if (not error.empty())
+			{
+				nlohmann::json j;
+				j["sequence"]	= sequence;
+				j["error"]		= error;
+				text = j.dump(4);
+			}
+
+			auto rs = result_slot(sequence % header->number_of_slots);
+			const size_t max_length = header->result_slot_size - sizeof(DarkHelp::SharedMemory::ResultSlot);
+			if (text.size() > max_length)
+			{
+				text = "{\"sequence\": " + std::to_string(sequence) + ", \"error\": \"results are larger than " + std::to_string(max_length) + " bytes\"}";
+			}
+
+			/* This works like a seqlock:  the sequence number is cleared before the results are overwritten, so a producer
+			 * which is still copying the previous results from this slot will see the sequence number has changed when it
+			 * checks it again after the copy.  @see @ref DarkHelp::SharedMemory::ResultSlot
+			 */
+			rs->sequence.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			std::memcpy(reinterpret_cast<uint8_t *>(rs) + sizeof(DarkHelp::SharedMemory::ResultSlot), text.data(), text.size());
+			rs->length = text.size();
+			rs->sequence.store(sequence, std::memory_order_release);
+
+			// once the results have been published, the producer is free to re-use the frame slot
+			frame_slot(sequence % header->number_of_slots)->consumed.store(sequence, std::memory_order_release);
+			wake(rs->futex);
+
+			return;
+		}
+
+		/// Wake up all the producers waiting on this futex.  @see @ref DarkHelp::SharedMemory::ResultSlot
+		static void wake(std::atomic<uint32_t> & futex)
+		{
+			static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) and std::atomic<uint32_t>::is_always_lock_free);
+
+			futex.fetch_add(1, std::memory_order_release);
+			syscall(SYS_futex, reinterpret_cast<uint32_t *>(&futex), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+
+			return;
+		}
+
+		void run()
+		{
+			uint64_t expected_sequence = 1;
+			auto waiting_since = std::chrono::steady_clock::now();
+
+			while (not stop_requested)
+			{
+				timespec ts;
+				clock_gettime(CLOCK_REALTIME, &ts);
+				ts.tv_nsec += 100000000; // 100 milliseconds
+				if (ts.tv_nsec >= 1000000000)
+				{
+					ts.tv_sec	+= 1;
+					ts.tv_nsec	-= 1000000000;
+				}
+				sem_timedwait(&header->frames_available, &ts);
+
+				/* With multiple producers, frames may be published out of order, so the semaphore is only used to wake up.
+				 * We then consume as many frames as possible, strictly in order of sequence number.
+				 */
+				while (not stop_requested)
+				{
+					const uint64_t sequence = expected_sequence;
+					const uint64_t previous = (sequence > header->number_of_slots ? sequence - header->number_of_slots : 0);
+					auto fs = frame_slot(sequence % header->number_of_slots);
+					const auto now = std::chrono::steady_clock::now();
+
+					if (fs->sequence.load(std::memory_order_acquire) != sequence)
+					{
+						if (header->next_sequence.load(std::memory_order_acquire) <= sequence or
+							fs->consumed.load(std::memory_order_acquire) != previous)
+						{
+							// nobody has reserved this sequence number yet, or we're still using the slot for the previous frame
+							waiting_since = now;
+							break;
+						}
+
+						if (now < waiting_since + frame_timeout)
+						{
+							break;
+						}
+
+						/* The producer which reserved this sequence number has not published the frame, and may have died.
+						 * Claim the slot so a late producer cannot publish the frame, and skip this sequence number.
+						 */
+						uint64_t current = previous;
+						if (not fs->sequence.compare_exchange_strong(current, sequence, std::memory_order_acq_rel))
+						{
+							if (current == sequence)
+							{
+								// the producer published the frame at the last moment
+								continue;
+							}
+
+							// the slot contains an unexpected sequence number, so claim it anyway or the next producer would be blocked
+							fs->sequence.store(sequence, std::memory_order_release);
+						}
+
+						std::cout << "-> skipping shared memory frame #" << sequence << " which was reserved but never published" << std::endl;
+						expected_sequence ++;
+						waiting_since = now;
+						publish_results(sequence, "", "timed out waiting for frame #" + std::to_string(sequence) + " to be published");
+						continue;
+					}
+					expected_sequence ++;
+					waiting_since = now;
+
+					/* The frame header is written by the producer and cannot be trusted.  Read it once, and do all the size
+					 * calculations using 64-bit values so a large width cannot wrap around and pass the checks.
+					 */
+					const uint64_t max_frame_size	= header->frame_slot_size - sizeof(DarkHelp::SharedMemory::FrameSlot);
+					const uint64_t width			= fs->width;
+					const uint64_t height			= fs->height;
+					const uint64_t stride			= fs->stride;
+					const uint32_t format			= fs->format;
+					if (format != DarkHelp::SharedMemory::kFormatBGR or
+						width < 1 or width > INT_MAX or
+						height < 1 or height > INT_MAX or
+						stride < width * 3 or
+						stride * height > max_frame_size)
+					{
+						publish_results(sequence, "", "invalid frame: " + std::to_string(width) + " x " + std::to_string(height) + ", stride=" + std::to_string(stride) + ", format=" + std::to_string(format));
+						continue;
+					}
+
+					try
+					{
+						const auto timestamp = std::chrono::high_resolution_clock::now();
+						last_activity = timestamp;
+
+						// no copy is made -- the cv::Mat points directly to the frame in shared memory
+						uint8_t * data = reinterpret_cast<uint8_t *>(fs) + sizeof(DarkHelp::SharedMemory::FrameSlot);
+
+						auto job = std::make_shared<ImageJob>();
+						job->index		= ++ total_number_of_images_processed;
+						job->timestamp	= timestamp;
+						job->mat		= cv::Mat(static_cast<int>(height), static_cast<int>(width), CV_8UC3, data, static_cast<size_t>(stride));
+						job->reply		= [this, sequence](const std::string & json, const std::string & error)
+						{
+							publish_results(sequence, json, error);
+						};
+						inference_queue.push(job);
+					}
+					catch (const std::exception & e)
+					{
+						// an exception must not escape this thread, otherwise any producer could terminate the server
+						publish_results(sequence, "", e.what());
+					}
+				}
+			}
+
+			return;
+		}
+
+		JobQueue & inference_queue;
+		std::atomic<bool> stop_requested;
+		std::chrono::steady_clock::duration frame_timeout;
+		std::string shm_name;
+		int shm_fd;
+		size_t shm_size;
+		uint8_t * shm;
+		DarkHelp::SharedMemory::Header * header;
+		std::thread listener_thread;
+};
+#endif
+
+
+void server(DarkHelp::NN & nn, const nlohmann::json & j, DarkHelp::ModelCache::SPModel model)
+{
+	const auto & server_settings = j["darkhelp"]["server"]["settings"];
+
+	auto input_dir		= std::filesystem::path(server_settings["input_directory"].get<std::string>());
+	auto output_dir		= std::filesystem::path(server_settings["output_directory"].get<std::string>());
+
+	if (server_settings["clear_output_directory_on_startup"])
+	{
+		std::filesystem::remove_all(output_dir);
+	}
+
+	std::filesystem::create_directories(input_dir);
+	std::filesystem::create_directories(output_dir);
+
+	std::cout << "-> DarkHelp Server is now running..." << std::endl;
+
+	const auto idle_timeout_in_seconds = std::chrono::seconds(server_settings["idle_time_in_seconds"]);
+	const bool exit_if_idle								= server_settings["exit_if_idle"					];
+	const int max_images_to_process_at_once				= server_settings["max_images_to_process_at_once"	];
+	const bool purge_files_after_cmd_completes			= server_settings["purge_files_after_cmd_completes"	];
+	const std::string run_cmd_after_processing_images	= server_settings["run_cmd_after_processing_images"	];
+	const bool use_camera_for_input						= server_settings["use_camera_for_input"			];
+	const bool use_inotify								= server_settings["use_inotify"						];
+	crop_and_save_detected_objects						= server_settings["crop_and_save_detected_objects"	];
+	save_annotated_image								= server_settings["save_annotated_image"			];
+	save_txt_annotations								= server_settings["save_txt_annotations"			];
+	save_json_results									= server_settings["save_json_results"				];
+	apply_roi											= server_settings["apply_roi"						] ;
+	const bool save_original_image						= server_settings["camera"]["save_original_image"	];
+	const int worker_threads							= server_settings["worker_threads"					];
+	const int writer_threads							= server_settings["writer_threads"					];
+
+	if (worker_threads < 1 or worker_threads > 32)
+	{
+		// same upper limit as what is used in DarkHelp::DHThreads
+		throw std::invalid_argument("number of worker threads seems to be unusual: " + std::to_string(worker_threads));
+	}
+	if (writer_threads < 0 or writer_threads > 64)
+	{
+		throw std::invalid_argument("number of writer threads seems to be unusual: " + std::to_string(writer_threads));
+	}
+
+	cv::VideoCapture cap;
+	std::unique_ptr<DarkHelp::FrameGrabber> grabber;
+	if (use_camera_for_input)
+	{
+		const auto & camera = server_settings["camera"];
+
+		std::string name	= camera["name"			];
+		int bufferSize		= camera["buffersize"	];
+		int width			= camera["width"		];
+		int height			= camera["height"		];
+		int fps				= camera["fps"			];
+
+		std::cout << "-> configuring camera device \"" << name << "\" to use " << width << " x " << height << " @ " << fps << " FPS with a buffer size of " << bufferSize << std::endl;
+		if (name.empty() == false and name[0] >= '0' and name[0] <= '9')
+		{
+			int index = std::stoi(name);
+			cap.open(index);
+		}
+		else
+		{
+			cap.open(name);
+		}
+		if (cap.isOpened() == false)
+		{
+			throw std::invalid_argument("failed to open camera device " + name);
+		}
+		cap.set(cv::VideoCaptureProperties::CAP_PROP_BUFFERSIZE		, bufferSize	);
+		cap.set(cv::VideoCaptureProperties::CAP_PROP_FRAME_WIDTH	, width			);
+		cap.set(cv::VideoCaptureProperties::CAP_PROP_FRAME_HEIGHT	, height		);
+		cap.set(cv::VideoCaptureProperties::CAP_PROP_FPS			, fps			);
+
+		cv::Mat mat;
+		cap >> mat;
+		if (mat.empty())
+		{
+			std::cout << "WARNING: reading from camera device " << name << " is returning empty frames" << std::endl;
+		}
+
+		bufferSize	= cap.get(cv::VideoCaptureProperties::CAP_PROP_BUFFERSIZE	);
+		width		= cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_WIDTH	);
+		height		= cap.get(cv::VideoCaptureProperties::CAP_PROP_FRAME_HEIGHT	);
+		fps			= cap.get(cv::VideoCaptureProperties::CAP_PROP_FPS			);
+		std::cout << "-> camera device " + name + " is reporting " << width << " x " << height << " @ " << fps << " FPS with a buffer size of " << bufferSize << std::endl;
+		std::cout << "-> actual frame from camera device " + name + " measures " << mat.cols << " x " << mat.rows << std::endl;
+
+		if (camera["latest_frame_only"])
+		{
+			// read frames on a secondary thread so we always run inference on the most recent frame
+			std::cout << "-> reading camera frames on a secondary thread" << std::endl;
+			grabber = std::make_unique<DarkHelp::FrameGrabber>(cap);
+		}
+	}
+	else
+	{
+		std::cout << "-> reading images from directory " << input_dir.string() << std::endl;
+		if (use_inotify and start_inotify(input_dir))
+		{
+			std::cout << "-> using inotify to watch for new images" << std::endl;
+		}
+	}
+
+	/* The network that was loaded by the caller is used by the first inference thread.  Each additional inference thread
+	 * needs to load its own copy of the network.  Nothing is written to disk when loading from memory, so the copies are
+	 * all loaded at the same time from the model which was already read by the caller.
+	 */
+	std::vector<std::unique_ptr<DarkHelp::NN>> additional_networks;
+	std::vector<DarkHelp::NN *> networks = {&nn};
+	if (worker_threads > 1)
+	{
+		std::cout << "-> loading " << (worker_threads - 1) << " additional cop" << (worker_threads == 2 ? "y" : "ies") << " of the neural network" << std::endl;
+		std::vector<std::future<void>> loaders;
+		for (int idx = 1; idx < worker_threads; idx ++)
+		{
+			additional_networks.push_back(std::make_unique<DarkHelp::NN>());
+			networks.push_back(additional_networks.back().get());
+			loaders.push_back(std::async(std::launch::async, [&j, &model, net = networks.back()]()
+			{
+				configure(*net, j, model, false);
+			}));
+		}
+		for (auto & f : loaders)
+		{
+			// re-throws if a network failed to load (the destructors of the remaining futures wait for the other threads)
+			f.get();
+		}
+	}
+
+	// every network has been loaded, so there is no reason to keep the .cfg, .names, and .weights in memory
+	model.reset();
+
+	/* Inference threads pull images from the inference queue.  Once an image has been processed, it is handed over to the
+	 * writer threads which save the annotated image, .txt, .json, and crops to the output directory.  If there are no
+	 * writer threads, then the inference threads save the output files themselves.  Both queues are bounded so we don't
+	 * end up reading images from disk (or from the camera) faster than what can be processed.
+	 */
+	JobQueue inference_queue(2 * worker_threads);
+	JobQueue writer_queue(4 * std::max(1, writer_threads));
+	JobCounter main_loop_jobs;
+	std::vector<std::thread> threads;
+	for (int idx = 0; idx < worker_threads; idx ++)
+	{
+		threads.emplace_back(inference_thread, idx, std::ref(*networks[idx]), std::ref(inference_queue), std::ref(writer_queue), writer_threads > 0);
+	}
+	for (int idx = 0; idx < writer_threads; idx ++)
+	{
+		threads.emplace_back(writer_thread, idx, std::ref(writer_queue));
+	}
+	std::cout << "-> using " << worker_threads << " inference thread" << (worker_threads == 1 ? "" : "s") << " and " << writer_threads << " writer thread" << (writer_threads == 1 ? "" : "s") << std::endl;
+
+	/* Make sure the threads are always stopped and joined when we leave this function, including when an exception is
+	 * thrown, otherwise the std::thread destructor would terminate the application.
+	 */
+	struct ThreadCleanup final
+	{
+		std::function<void()> f;
+		~ThreadCleanup() { f(); }
+	} thread_cleanup{[&]()
+	{
+		inference_queue.stop();
+		writer_queue.stop();
+		for (auto & t : threads)
+		{
+			if (t.joinable())
+			{
+				t.join();
+			}
+		}
+	}};
+
+	const std::string listen_unix_socket	= server_settings["listen"]["unix_socket"				];
+	const int listen_tcp_port				= server_settings["listen"]["tcp_port"					];
+	const size_t max_image_size_in_bytes	= server_settings["listen"]["max_image_size_in_bytes"	];
+	#ifndef WIN32
+	// this is declared after the thread cleanup so the connections are closed before the inference threads are stopped
+	RequestListener listener(inference_queue, max_image_size_in_bytes);
+	if (not listen_unix_socket.empty())
+	{
+		listener.listen_on_unix_socket(listen_unix_socket);
+	}
+	if (listen_tcp_port > 0)
+	{
+		listener.listen_on_tcp_port(listen_tcp_port);
+	}
+	#else
+	if (not listen_unix_socket.empty() or listen_tcp_port > 0)
+	{
+		std::cout << "-> WARNING: listening for requests is not supported on this platform" << std::endl;
+	}
+	#endif
+
+	const auto & shared_memory = server_settings["shared_memory"];
+	const std::string shared_memory_name = shared_memory["name"];
+	#ifdef __linux__
+	SharedMemoryListener shared_memory_listener(inference_queue);
+	if (not shared_memory_name.empty())
+	{
+		shared_memory_listener.start(
+			shared_memory_name,
+			shared_memory["slots"					],
+			shared_memory["max_frame_size_in_bytes"		],
+			shared_memory["max_result_size_in_bytes"	],
+			shared_memory["frame_timeout_in_milliseconds"]);
+	}
+	#else
+	if (not shared_memory_name.empty())
+	{
+		std::cout << "-> WARNING: shared memory input is not supported on this platform" << std::endl;
+	}
+	#endif
+
+	int images_processed = 0;
+	auto previous_timestamp = std::chrono::high_resolution_clock::now();
+	size_t previous_jobs_completed = 0;
+	std::filesystem::directory_iterator dir_iter;
+
+	while (true)
+	{
+		const auto now = std::chrono::high_resolution_clock::now();
+
+		if (exit_if_idle and now > last_activity.load() + idle_timeout_in_seconds)
+		{
+			std::cout << "-> idle timeout detected after " << idle_timeout_in_seconds.count() << " seconds" << std::endl;
+			break;
+		}
+
+		cv::Mat mat;
+		std::string dst_stem;
+
+		if (use_camera_for_input)
+		{
+			if (grabber)
+			{
+				// don't grab a frame until an inference thread is ready for it, otherwise it will be stale by the time it is processed
+				inference_queue.wait_for_available_thread(worker_threads);
+				mat = grabber->get_latest_frame();
+			}
+			else
+			{
+				cap >> mat;
+			}
+			dst_stem = (output_dir / ("frame_" + std::to_string(total_number_of_images_processed))).string();
+
+			if (save_original_image and not mat.empty())
+			{
+				cv::imwrite(dst_stem + ".jpg", mat, {cv::ImwriteFlags::IMWRITE_JPEG_QUALITY, 70});
+			}
+		}
+		else
+		{
+			/* When polling, we re-scan the input directory every time we reach the end of the directory iterator.  But
+			 * when inotify is used, the directory only needs to be scanned once at startup (or if the kernel tells us
+			 * events were dropped), and from then on we get the filenames directly from the inotify events.
+			 */
+			if (dir_iter == std::filesystem::directory_iterator() and (inotify_fd < 0 or inotify_rescan_needed))
+			{
+				inotify_rescan_needed = false;
+				dir_iter = std::filesystem::directory_iterator(
+					input_dir														,
+					std::filesystem::directory_options::follow_directory_symlink	|
+					std::filesystem::directory_options::skip_permission_denied		);
+			}
+
+			std::filesystem::path src;
+			if (dir_iter != std::filesystem::directory_iterator())
+			{
+				src = dir_iter->path();
+				dir_iter ++;
+			}
+			else if (inotify_pending_files.empty() == false)
+			{
+				src = inotify_pending_files.front();
+				inotify_pending_files.pop_front();
+			}
+
+			if (src.empty() == false)
+			{
+
+				if (std::filesystem::exists(src) == false)
+				{
+					// file has since been deleted -- nothing we can do but move on
+					if (src.extension() != ".roi")
+					{
+						std::cout << "skipping (no longer exists?): " << src << std::endl;
+					}
+					continue;
+				}
+
+				std::cout << "-> [" << total_number_of_images_processed << "] " << src.string() << std::endl;
+				auto dst = output_dir / src.filename();
+				dst_stem = (output_dir / src.stem()).string();
 
 				// on older versions of OpenCV, such as the one from Ubuntu 18.04,
 				// cv::imread() will throw instead of returning an empty cv::mat
@@ -555,19 +1970,47 @@ void server(DarkHelp::NN & nn, const nlohmann::json & j)
 
 		if (mat.empty() == false)
 		{
-			process_image(nn, mat, dst_stem);
+			last_activity = now;
+
+			auto job = std::make_shared<ImageJob>();
+			job->index		= ++ total_number_of_images_processed;
+			job->timestamp	= now;
+			job->mat		= mat;
+			job->stem		= dst_stem;
+			job->roi		= roi_rectangles;
+			job->counter	= &main_loop_jobs;
+			main_loop_jobs.submitted();
+			inference_queue.push(job);
+
 			images_processed ++;
 		}
 
 		if ((mat.empty() and images_processed > 0) or
 			(max_images_to_process_at_once > 0 and images_processed >= max_images_to_process_at_once))
 		{
-			static auto previous_timestamp = now;
-			if (now > previous_timestamp)
+			/* Only the external command needs all of the results to be available.  Otherwise we keep the inference
+			 * threads busy by reading the next image while the previous ones are still being processed, and the FPS is
+			 * calculated from the number of images which have completed since the last time it was reported.
+			 */
+			if (run_cmd_after_processing_images.empty() == false)
+			{
+				main_loop_jobs.wait_until_idle();
+			}
+
+			const auto report_timestamp = std::chrono::high_resolution_clock::now();
+			const size_t jobs_completed = main_loop_jobs.completed();
+			if (report_timestamp > previous_timestamp and jobs_completed > previous_jobs_completed)
 			{
-				const double nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(now - previous_timestamp).count();
-				const double fps = static_cast<double>(images_processed) / nanoseconds * 1000000000.0;
+				const double nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(report_timestamp - previous_timestamp).count();
+				const double fps = static_cast<double>(jobs_completed - previous_jobs_completed) / nanoseconds * 1000000000.0;
 				std::cout << "-> " << std::fixed << std::setprecision(1) << fps << " FPS" << std::endl;
+				previous_timestamp		= report_timestamp;
+				previous_jobs_completed	= jobs_completed;
+			}
+
+			if (grabber)
+			{
+				std::cout << "-> camera frames read: " << grabber->frames_read() << ", dropped: " << grabber->frames_dropped() << ", errors: " << grabber->read_errors() << std::endl;
 			}
 
 			if (run_cmd_after_processing_images.empty() == false)
@@ -586,16 +2029,32 @@ void server(DarkHelp::NN & nn, const nlohmann::json & j)
 				}
 			}
 
-			previous_timestamp = now;
 			images_processed = 0;
 		}
 
 		if (mat.empty())
 		{
-			std::this_thread::sleep_for(std::chrono::seconds(1));
+			if (use_camera_for_input)
+			{
+				std::this_thread::sleep_for(std::chrono::seconds(1));
+			}
+			else
+			{
+				wait_for_new_images(input_dir);
+			}
 		}
 	}
 
+	main_loop_jobs.wait_until_idle();
+
+	#ifdef __linux__
+	if (inotify_fd >= 0)
+	{
+		close(inotify_fd);
+		inotify_fd = -1;
+	}
+	#endif
+
 	return;
 }
 
@@ -646,8 +2105,9 @@ int main(int argc, char *argv[])
 			}
 
 			DarkHelp::NN nn;
-			configure(nn, settings);
-			server(nn, settings);
+			auto model = load_model(settings);
+			configure(nn, settings, model);
+			server(nn, settings, std::move(model));
 
 			rc = 0;
 		}